@@ -0,0 +1,301 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioFifo.h"
+#include "MemoryResidency.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define STARNAILS_ASRC_SSE2 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+ #include <arm_neon.h>
+ #define STARNAILS_ASRC_NEON 1
+#endif
+
+// Drift-tracking sample-rate converter that reads from a FIFO filled on another clock.
+//
+// The consumer asks for exactly as many samples as its own device wants. How much input
+// that takes depends on the ratio between the two clocks, which nobody knows exactly, so
+// it is steered instead: a PI controller watches how much input is buffered and nudges
+// the ratio until the fill sits at the latency target. Drift between two crystals is a
+// few hundred ppm at most, so the correction is bounded to a fraction of a percent and
+// is far too slow to hear.
+//
+// Interpolation is a windowed-sinc polyphase filter, 32 taps by 128 phases, with linear
+// interpolation between neighbouring phases. The filter is SSE2/NEON, four taps at a
+// time. If the FIFO runs dry or overfills anyway (a stalled device, say), the stream is
+// resynchronised at the target fill and counted.
+class AdaptiveResampler
+{
+public:
+    static constexpr int numTaps = 32;
+    static constexpr int numPhases = 128;
+
+    // Message thread, while the consumer is stopped. targetFill is in input samples.
+    void prepare (int numChannels, double inputRate, double outputRate, int maxOutputBlock, int targetFill)
+    {
+        nominalRatio = inputRate / outputRate;
+        outputSampleRate = outputRate;
+        maxOutputBlockSize = maxOutputBlock;
+        target = juce::jmax (numTaps, targetFill);
+
+        const int maxInputBlock = (int) std::ceil (maxOutputBlock * nominalRatio * (1.0 + maxCorrection)) + 2;
+        window.setSize (numChannels, numTaps + maxInputBlock + 1, false, true, false);
+        MemoryResidency::prefault (window);
+
+        buildKernel (0.5 * juce::jmin (1.0, 1.0 / nominalRatio) * 0.92);
+
+        running = false;
+        available = 0;
+        position = 0.0;
+        integral = 0.0;
+        smoothedFill = target;
+        ratio.store (nominalRatio);
+    }
+
+    // Consumer thread. Writes numSamples to each of the first getNumChannels() channels
+    // of dest.
+    void process (AudioFifo& fifo, juce::AudioBuffer<float>& dest, int numSamples) noexcept
+    {
+        const int numChannels = juce::jmin (window.getNumChannels(), dest.getNumChannels());
+
+        if (numSamples > maxOutputBlockSize)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                dest.clear (ch, maxOutputBlockSize, numSamples - maxOutputBlockSize);
+
+            numSamples = maxOutputBlockSize;
+        }
+
+        if (! running && ! start (fifo))
+        {
+            clear (dest, numChannels, numSamples);
+            return;
+        }
+
+        const double buffered = fifo.getNumReady() + (available - position);
+        fill.store ((int) buffered);
+
+        if (buffered > 4.0 * target + window.getNumSamples())
+        {
+            resync (dest, numChannels, numSamples);
+            return;
+        }
+
+        steer (buffered, numSamples);
+        const double step = ratio.load (std::memory_order_relaxed);
+
+        // Input needed for this block: the taps under the last output sample, plus one
+        // for the phase interpolation.
+        const int needed = juce::jmin (window.getNumSamples(), (int) std::ceil (position + numSamples * step) + numTaps + 1);
+
+        if (needed > available)
+        {
+            const int wanted = needed - available;
+
+            if (fifo.getNumReady() < wanted)
+            {
+                resync (dest, numChannels, numSamples);
+                return;
+            }
+
+            fifo.pull (window, available, wanted);
+            available += wanted;
+        }
+
+        render (dest, numChannels, numSamples, step);
+        discardConsumed();
+    }
+
+    int getNumChannels() const noexcept             { return window.getNumChannels(); }
+    double getRatio() const noexcept                { return ratio.load(); }
+    double getCorrectionPpm() const noexcept        { return (ratio.load() / nominalRatio - 1.0) * 1.0e6; }
+    int getFillSamples() const noexcept             { return fill.load(); }
+    int getResyncCount() const noexcept             { return resyncs.load(); }
+
+private:
+    bool start (AudioFifo& fifo) noexcept
+    {
+        const int ready = fifo.getNumReady();
+
+        if (ready < target + numTaps)
+            return false;
+
+        // Drop the surplus so playback starts right at the target latency.
+        fifo.discard (ready - target - numTaps);
+
+        const int primed = fifo.pull (window, 0, numTaps);
+        available = primed;
+        position = 0.0;
+        integral = 0.0;
+        smoothedFill = target;
+        ratio.store (nominalRatio);
+        running = primed == numTaps;
+        return running;
+    }
+
+    void resync (juce::AudioBuffer<float>& dest, int numChannels, int numSamples) noexcept
+    {
+        running = false;
+        resyncs.fetch_add (1);
+        clear (dest, numChannels, numSamples);
+    }
+
+    void steer (double buffered, int numSamples) noexcept
+    {
+        const double blockSeconds = numSamples / outputSampleRate;
+
+        // The fill is lumpy at the scale of the two devices' block sizes, so the
+        // controller sees it through a one-second smoother.
+        smoothedFill += (buffered - smoothedFill) * juce::jmin (1.0, blockSeconds / fillSmoothingSeconds);
+
+        const double error = (smoothedFill - target) / target;
+        integral = juce::jlimit (-integralLimit, integralLimit, integral + error * blockSeconds);
+
+        const double correction = juce::jlimit (-maxCorrection, maxCorrection, proportionalGain * error + integralGain * integral);
+        ratio.store (nominalRatio * (1.0 + correction), std::memory_order_relaxed);
+    }
+
+    void render (juce::AudioBuffer<float>& dest, int numChannels, int numSamples, double step) noexcept
+    {
+        const float* kernelData = kernel.data();
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const int index = (int) position;
+            const double phase = (position - index) * numPhases;
+            const int phaseIndex = juce::jmin (numPhases - 1, (int) phase);
+            const float blend = (float) (phase - phaseIndex);
+
+            const float* k0 = kernelData + (size_t) phaseIndex * numTaps;
+            const float* k1 = k0 + numTaps;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                dest.getWritePointer (ch)[i] = convolve (window.getReadPointer (ch, index), k0, k1, blend);
+
+            position += step;
+        }
+    }
+
+    void discardConsumed() noexcept
+    {
+        const int consumed = juce::jmin (available, (int) position);
+
+        if (consumed <= 0)
+            return;
+
+        for (int ch = 0; ch < window.getNumChannels(); ++ch)
+        {
+            auto* data = window.getWritePointer (ch);
+            std::memmove (data, data + consumed, sizeof (float) * (size_t) (available - consumed));
+        }
+
+        available -= consumed;
+        position -= consumed;
+    }
+
+    static void clear (juce::AudioBuffer<float>& dest, int numChannels, int numSamples) noexcept
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            dest.clear (ch, 0, numSamples);
+    }
+
+    // One output sample: the taps against the kernel interpolated between two phases.
+    static float convolve (const float* x, const float* k0, const float* k1, float blend) noexcept
+    {
+       #if STARNAILS_ASRC_SSE2
+        const __m128 b = _mm_set1_ps (blend);
+        __m128 acc = _mm_setzero_ps();
+
+        for (int j = 0; j < numTaps; j += 4)
+        {
+            const __m128 a0 = _mm_loadu_ps (k0 + j);
+            const __m128 k = _mm_add_ps (a0, _mm_mul_ps (b, _mm_sub_ps (_mm_loadu_ps (k1 + j), a0)));
+            acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (x + j), k));
+        }
+
+        acc = _mm_add_ps (acc, _mm_movehl_ps (acc, acc));
+        acc = _mm_add_ss (acc, _mm_shuffle_ps (acc, acc, 1));
+        return _mm_cvtss_f32 (acc);
+       #elif STARNAILS_ASRC_NEON
+        const float32x4_t b = vdupq_n_f32 (blend);
+        float32x4_t acc = vdupq_n_f32 (0.0f);
+
+        for (int j = 0; j < numTaps; j += 4)
+        {
+            const float32x4_t a0 = vld1q_f32 (k0 + j);
+            const float32x4_t k = vmlaq_f32 (a0, b, vsubq_f32 (vld1q_f32 (k1 + j), a0));
+            acc = vmlaq_f32 (acc, vld1q_f32 (x + j), k);
+        }
+
+        const float32x2_t pair = vadd_f32 (vget_low_f32 (acc), vget_high_f32 (acc));
+        return vget_lane_f32 (vpadd_f32 (pair, pair), 0);
+       #else
+        float acc = 0.0f;
+
+        for (int j = 0; j < numTaps; ++j)
+            acc += x[j] * (k0[j] + blend * (k1[j] - k0[j]));
+
+        return acc;
+       #endif
+    }
+
+    // Blackman-windowed sinc, one row of taps per phase plus a closing row so phase
+    // interpolation never reads past the table. Each row is normalised to unity gain.
+    void buildKernel (double cutoff)
+    {
+        kernel.assign ((size_t) (numPhases + 1) * numTaps, 0.0f);
+        const double centre = numTaps / 2 - 1;
+
+        for (int p = 0; p <= numPhases; ++p)
+        {
+            auto* row = kernel.data() + (size_t) p * numTaps;
+            const double fraction = (double) p / numPhases;
+            double sum = 0.0;
+
+            for (int j = 0; j < numTaps; ++j)
+            {
+                const double d = j - centre - fraction;
+                const double x = 2.0 * cutoff * d;
+                const double sinc = std::abs (x) < 1.0e-9 ? 1.0 : std::sin (juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+                const double w = (d + numTaps / 2) / numTaps;
+                const double blackman = 0.42 - 0.5 * std::cos (juce::MathConstants<double>::twoPi * w) + 0.08 * std::cos (2.0 * juce::MathConstants<double>::twoPi * w);
+                const double value = 2.0 * cutoff * sinc * juce::jmax (0.0, blackman);
+
+                row[j] = (float) value;
+                sum += value;
+            }
+
+            for (int j = 0; j < numTaps; ++j)
+                row[j] = (float) (row[j] / sum);
+        }
+    }
+
+    static constexpr double maxCorrection = 0.005;          // +-5000 ppm
+    static constexpr double proportionalGain = 1.0e-3;
+    static constexpr double integralGain = 1.0e-4;
+    static constexpr double integralLimit = maxCorrection / integralGain;
+    static constexpr double fillSmoothingSeconds = 1.0;
+
+    std::vector<float> kernel;
+    juce::AudioBuffer<float> window;
+    double nominalRatio = 1.0;
+    double outputSampleRate = 44100.0;
+    int maxOutputBlockSize = 0;
+    int target = numTaps;
+
+    // Consumer thread only.
+    bool running = false;
+    int available = 0;          // input samples in window
+    double position = 0.0;      // read position in window, in input samples
+    double integral = 0.0;
+    double smoothedFill = 0.0;
+
+    std::atomic<double> ratio { 1.0 };
+    std::atomic<int> fill { 0 };
+    std::atomic<int> resyncs { 0 };
+};
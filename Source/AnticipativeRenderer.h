@@ -0,0 +1,117 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioFifo.h"
+#include "RealtimeScheduling.h"
+#include <atomic>
+#include <functional>
+
+// Runs the render function on a real-time worker thread a configurable number of blocks
+// ahead of the device callback. The callback only pushes its input into one lock-free
+// ring and pulls already rendered output from another, so a slow plugin block eats into
+// the lookahead instead of turning into an xrun. The price is lookahead * blockSize
+// samples of extra latency.
+class AnticipativeRenderer : private juce::Thread
+{
+public:
+    using RenderFunction = std::function<void (juce::AudioBuffer<float>&)>;
+
+    AnticipativeRenderer() : juce::Thread ("DSP worker") {}
+
+    ~AnticipativeRenderer() override
+    {
+        stop();
+    }
+
+    // Message thread, while the audio callback is stopped.
+    void start (double sampleRate, int numChannels, int blockSize, int lookaheadBlocks, RenderFunction fn)
+    {
+        stop();
+
+        render = std::move (fn);
+        maxBlockSize = juce::jmax (1, blockSize);
+        latencySamples = juce::jmax (1, lookaheadBlocks) * maxBlockSize;
+
+        // Room for the lookahead plus a couple of blocks of slack on either side.
+        const int capacity = latencySamples + 4 * maxBlockSize;
+        input.setSize (numChannels, capacity);
+        output.setSize (numChannels, capacity);
+        workBuffer.setSize (numChannels, maxBlockSize, false, true, false);
+        MemoryResidency::prefault (workBuffer);
+
+        // Prime the output with silence; that is the latency we trade for headroom.
+        output.pushSilence (latencySamples);
+
+        underruns.store (0);
+
+        if (! startRealtimeThread (juce::Thread::RealtimeOptions{}.withPriority (9)
+                                                                  .withApproximateAudioProcessingTime (maxBlockSize, sampleRate)))
+            startThread (juce::Thread::Priority::highest);
+    }
+
+    void stop()
+    {
+        stopThread (2000);
+    }
+
+    bool isRunning() const noexcept          { return isThreadRunning(); }
+    int getLatencySamples() const noexcept   { return isThreadRunning() ? latencySamples : 0; }
+    int getUnderrunCount() const noexcept    { return underruns.load(); }
+
+    //==============================================================================
+    // Audio thread.
+    void process (juce::AudioBuffer<float>& buffer) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+
+        if (input.push (buffer, 0, numSamples) < numSamples)
+            underruns.fetch_add (1);
+
+        // Waking the worker takes the event's lock very briefly; it is never held
+        // across any real work.
+        notify();
+
+        const int numRead = output.pull (buffer, 0, numSamples);
+
+        if (numRead < numSamples)
+        {
+            buffer.clear (numRead, numSamples - numRead);
+            underruns.fetch_add (1);
+        }
+    }
+
+private:
+    void run() override
+    {
+        RealtimeScheduling::applyToCurrentThread (RealtimeScheduling::Role::worker);
+        MemoryResidency::prefaultStack();
+
+        while (! threadShouldExit())
+        {
+            wait (20);
+
+            for (;;)
+            {
+                const int numToRender = juce::jmin (input.getNumReady(), maxBlockSize, output.getFreeSpace());
+
+                if (numToRender <= 0 || threadShouldExit())
+                    break;
+
+                juce::AudioBuffer<float> block (workBuffer.getArrayOfWritePointers(), workBuffer.getNumChannels(), numToRender);
+                input.pull (block, 0, numToRender);
+                render (block);
+                output.push (block, 0, numToRender);
+            }
+        }
+    }
+
+    RenderFunction render;
+    int maxBlockSize = 0;
+    int latencySamples = 0;
+
+    AudioFifo input, output;
+    juce::AudioBuffer<float> workBuffer;
+    std::atomic<int> underruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnticipativeRenderer)
+};
@@ -0,0 +1,130 @@
+#include "AsyncInputBridge.h"
+#include "RealtimeScheduling.h"
+#include "MemoryResidency.h"
+
+//==============================================================================
+AsyncInputBridge::~AsyncInputBridge()
+{
+    close();
+}
+
+juce::String AsyncInputBridge::open (juce::AudioIODeviceType& type, const juce::String& deviceName,
+                                     int numChannels, double preferredSampleRate)
+{
+    close();
+
+    type.scanForDevices();
+
+    if (! type.getDeviceNames (true).contains (deviceName))
+        return "Input device \"" + deviceName + "\" not found (" + type.getTypeName() + ")";
+
+    std::unique_ptr<juce::AudioIODevice> opened (type.createDevice ({}, deviceName));
+
+    if (opened == nullptr)
+        return "Couldn't create input device \"" + deviceName + "\"";
+
+    // Same nominal rate as the output if the device has it, so the resampler only
+    // has the drift to follow.
+    auto rates = opened->getAvailableSampleRates();
+    double rate = rates.contains (preferredSampleRate) ? preferredSampleRate : opened->getCurrentSampleRate();
+
+    if (rate <= 0.0 && ! rates.isEmpty())
+        rate = rates.getLast();
+
+    juce::BigInteger inputs;
+    inputs.setRange (0, numChannels, true);
+
+    auto error = opened->open (inputs, {}, rate, opened->getDefaultBufferSize());
+
+    if (error.isNotEmpty())
+        return "Input device \"" + deviceName + "\": " + error;
+
+    channels = juce::jmin (numChannels, opened->getActiveInputChannels().countNumberOfSetBits());
+    inputSampleRate = opened->getCurrentSampleRate();
+
+    // A second of capture is far more than the resampler ever lets build up before it
+    // resynchronises.
+    fifo.setSize (channels, juce::roundToInt (inputSampleRate) + 4 * opened->getCurrentBufferSizeSamples());
+
+    device = std::move (opened);
+    device->start (this);
+
+    juce::Logger::writeToLog ("Input device " + device->getName() + " at " + juce::String (inputSampleRate) + " Hz / "
+                              + juce::String (device->getCurrentBufferSizeSamples()) + " smp, "
+                              + juce::String (device->getActiveInputChannels().countNumberOfSetBits()) + " channels");
+    return {};
+}
+
+void AsyncInputBridge::close()
+{
+    if (device == nullptr)
+        return;
+
+    device->stop();
+    device->close();
+    device.reset();
+}
+
+void AsyncInputBridge::prepare (double outputSampleRate, int maxOutputBlockSize, int latencyMs)
+{
+    if (device == nullptr)
+        return;
+
+    resampler.prepare (channels, inputSampleRate, outputSampleRate, maxOutputBlockSize,
+                       juce::roundToInt (inputSampleRate * latencyMs / 1000.0));
+}
+
+void AsyncInputBridge::read (juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    resampler.process (fifo, buffer, numSamples);
+}
+
+juce::String AsyncInputBridge::getStatus() const
+{
+    if (device == nullptr)
+        return {};
+
+    const double ppm = resampler.getCorrectionPpm();
+
+    return "Input " + device->getName() + " " + juce::String (juce::roundToInt (inputSampleRate)) + " Hz, "
+           + juce::String (1000.0 * resampler.getFillSamples() / inputSampleRate, 1) + " ms, "
+           + (ppm >= 0.0 ? "+" : "") + juce::String (juce::roundToInt (ppm)) + " ppm"
+           + (resampler.getResyncCount() > 0 ? ", " + juce::String (resampler.getResyncCount()) + " resyncs" : juce::String());
+}
+
+//==============================================================================
+void AsyncInputBridge::audioDeviceAboutToStart (juce::AudioIODevice*)
+{
+    capturePinned.store (false);
+}
+
+void AsyncInputBridge::audioDeviceIOCallbackWithContext (const float* const* inputChannelData, int numInputChannels,
+                                                         float* const* outputChannelData, int numOutputChannels,
+                                                         int numSamples, const juce::AudioIODeviceCallbackContext&)
+{
+    if (! capturePinned.load (std::memory_order_relaxed))
+    {
+        capturePinned.store (true, std::memory_order_relaxed);
+        RealtimeScheduling::applyToCurrentThread (RealtimeScheduling::Role::audio);
+        MemoryResidency::prefaultStack();
+    }
+
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+        if (outputChannelData[ch] != nullptr)
+            juce::FloatVectorOperations::clear (outputChannelData[ch], numSamples);
+
+    if (numInputChannels <= 0)
+        return;
+
+    // A view, not a copy: the FIFO only reads from it.
+    const juce::AudioBuffer<float> capture (const_cast<float* const*> (inputChannelData), numInputChannels, numSamples);
+
+    // Full means the output side has stalled; it resynchronises once it runs again.
+    if (fifo.push (capture, 0, numSamples) < numSamples)
+        droppedBlocks.fetch_add (1);
+}
+
+void AsyncInputBridge::audioDeviceError (const juce::String& errorMessage)
+{
+    juce::Logger::writeToLog ("Input device error: " + errorMessage);
+}
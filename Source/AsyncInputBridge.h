@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AdaptiveResampler.h"
+#include "AudioFifo.h"
+#include <atomic>
+#include <memory>
+
+// Captures a pipeline's input from a second device running on its own clock.
+//
+// Two interfaces never run at quite the same rate, so feeding one's input straight to
+// the other's output drops or repeats a block every so often. The capture device's
+// callback only pushes into a FIFO; the output callback pulls from it through an
+// AdaptiveResampler that follows the drift and holds the FIFO at a fixed latency.
+//
+// open/close/prepare are message thread; read is the output device's callback.
+class AsyncInputBridge  : private juce::AudioIODeviceCallback
+{
+public:
+    AsyncInputBridge() = default;
+    ~AsyncInputBridge() override;
+
+    // Opens the named capture device from the same driver type as the output device.
+    // Returns an error message on failure.
+    juce::String open (juce::AudioIODeviceType& type, const juce::String& deviceName,
+                       int numChannels, double preferredSampleRate);
+    void close();
+    bool isOpen() const noexcept                { return device != nullptr; }
+
+    // While the output callback is stopped.
+    void prepare (double outputSampleRate, int maxOutputBlockSize, int latencyMs);
+
+    // Replaces the first channels of buffer with the resampled capture.
+    void read (juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    // e.g. "Input USB Audio 48000 Hz, 5.1 ms, +42 ppm".
+    juce::String getStatus() const;
+    int getResyncCount() const noexcept         { return resampler.getResyncCount(); }
+    int getDroppedCount() const noexcept        { return droppedBlocks.load(); }
+
+private:
+    void audioDeviceIOCallbackWithContext (const float* const* inputChannelData, int numInputChannels,
+                                           float* const* outputChannelData, int numOutputChannels,
+                                           int numSamples, const juce::AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart (juce::AudioIODevice*) override;
+    void audioDeviceStopped() override {}
+    void audioDeviceError (const juce::String& errorMessage) override;
+
+    std::unique_ptr<juce::AudioIODevice> device;
+    AudioFifo fifo;
+    AdaptiveResampler resampler;
+    double inputSampleRate = 0.0;
+    int channels = 0;
+
+    std::atomic<bool> capturePinned { false };
+    std::atomic<int> droppedBlocks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AsyncInputBridge)
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryResidency.h"
+
+// Single-producer/single-consumer multichannel sample FIFO. Sizing happens on the
+// message thread; push and pull are lock-free and allocation-free.
+class AudioFifo
+{
+public:
+    void setSize (int numChannels, int capacity)
+    {
+        ring.setSize (numChannels, capacity + 1, false, true, false);
+        MemoryResidency::prefault (ring);
+        fifo.setTotalSize (capacity + 1);
+        reset();
+    }
+
+    // Only while neither side is running.
+    void reset() noexcept
+    {
+        ring.clear();
+        fifo.reset();
+    }
+
+    int getNumChannels() const noexcept  { return ring.getNumChannels(); }
+    int getNumReady() const noexcept     { return fifo.getNumReady(); }
+    int getFreeSpace() const noexcept    { return fifo.getFreeSpace(); }
+
+    // Both return the number of samples actually transferred.
+    int push (const juce::AudioBuffer<float>& source, int startSample, int numSamples) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+        const int numChannels = juce::jmin (ring.getNumChannels(), source.getNumChannels());
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (size1 > 0) ring.copyFrom (ch, start1, source, ch, startSample, size1);
+            if (size2 > 0) ring.copyFrom (ch, start2, source, ch, startSample + size1, size2);
+        }
+
+        fifo.finishedWrite (size1 + size2);
+        return size1 + size2;
+    }
+
+    int pull (juce::AudioBuffer<float>& dest, int startSample, int numSamples) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (numSamples, start1, size1, start2, size2);
+
+        const int numChannels = juce::jmin (ring.getNumChannels(), dest.getNumChannels());
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (size1 > 0) dest.copyFrom (ch, startSample, ring, ch, start1, size1);
+            if (size2 > 0) dest.copyFrom (ch, startSample + size1, ring, ch, start2, size2);
+        }
+
+        fifo.finishedRead (size1 + size2);
+        return size1 + size2;
+    }
+
+    // Consumer side: drops up to numSamples without copying them anywhere.
+    int discard (int numSamples) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (numSamples, start1, size1, start2, size2);
+        fifo.finishedRead (size1 + size2);
+        return size1 + size2;
+    }
+
+    int pushSilence (int numSamples) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < ring.getNumChannels(); ++ch)
+        {
+            if (size1 > 0) ring.clear (ch, start1, size1);
+            if (size2 > 0) ring.clear (ch, start2, size2);
+        }
+
+        fifo.finishedWrite (size1 + size2);
+        return size1 + size2;
+    }
+
+private:
+    juce::AbstractFifo fifo { 1 };
+    juce::AudioBuffer<float> ring;
+};
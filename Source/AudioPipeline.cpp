@@ -0,0 +1,1030 @@
+#include "AudioPipeline.h"
+
+//==============================================================================
+AudioPipeline::AudioPipeline (int pipelineIndex, const EngineSettings& engineSettings)
+    : index (pipelineIndex), settings (engineSettings),
+      numChannels (engineSettings.numChannels), numPairs (engineSettings.getNumChannelPairs()),
+      rmsInput ((size_t) numChannels), rmsOutput ((size_t) numChannels)
+{
+    for (int pair = 0; pair < numPairs; ++pair)
+    {
+        pairs.push_back (std::make_unique<ChannelPair>());
+        pairs.back()->swap.setCrossfadeBlocks (settings.crossfadeBlocks);
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        rmsInput[(size_t) ch].store (0.0f);
+        rmsOutput[(size_t) ch].store (0.0f);
+    }
+
+    parameterScheduler.setMinimumSubBlock (settings.minSubBlockSize);
+    routing.configure (settings);
+
+    bufferTuner.onSyntheticLoad = [this] (bool shouldLoad) { syntheticLoad.store (shouldLoad); };
+}
+
+AudioPipeline::~AudioPipeline()
+{
+    shutdown();
+}
+
+void AudioPipeline::start (int numInputChannels, int numOutputChannels)
+{
+    auto savedState = EngineSettings::loadXml (getDeviceStateKey());
+    const auto inputDevice = settings.getInputDevice (index);
+    auto error = deviceManager.initialise (inputDevice.isEmpty() ? numInputChannels : 0, numOutputChannels, savedState.get(), true);
+
+    if (error.isNotEmpty())
+        juce::Logger::writeToLog (getName() + ": " + error);
+
+    // Only the first zone takes the default device. The others stay closed until a
+    // device has been picked for them, rather than fighting over the same one.
+    if (savedState == nullptr && index > 0)
+        deviceManager.closeAudioDevice();
+
+    // Opened before our callback is added, so prepareToPlay finds it ready.
+    if (inputDevice.isNotEmpty())
+    {
+        auto* type = deviceManager.getCurrentDeviceTypeObject();
+        auto* output = deviceManager.getCurrentAudioDevice();
+        auto inputError = type != nullptr ? inputBridge.open (*type, inputDevice, numInputChannels,
+                                                              output != nullptr ? output->getCurrentSampleRate() : 48000.0)
+                                          : juce::String ("no audio driver for the input device");
+
+        if (inputError.isNotEmpty())
+            juce::Logger::writeToLog (getName() + ": " + inputError);
+    }
+
+    if (auto midiInput = settings.getMidiInput (index); midiInput.isNotEmpty())
+    {
+        auto midiError = midiControl.open (midiInput);
+
+        if (midiError.isNotEmpty())
+            juce::Logger::writeToLog (getName() + ": " + midiError);
+    }
+
+    deviceManager.addChangeListener (this);
+    sourcePlayer.setSource (this);
+    deviceManager.addAudioCallback (&sourcePlayer);
+}
+
+void AudioPipeline::shutdown()
+{
+    bufferTuner.cancel();
+    pluginLoader.cancel();
+    deviceManager.removeChangeListener (this);
+    sourcePlayer.setSource (nullptr);
+    deviceManager.removeAudioCallback (&sourcePlayer);
+    deviceManager.closeAudioDevice();
+    inputBridge.close();
+    midiControl.close();
+}
+
+void AudioPipeline::changeListenerCallback (juce::ChangeBroadcaster*)
+{
+    if (auto state = deviceManager.createStateXml())
+        EngineSettings::storeXml (getDeviceStateKey(), *state);
+}
+
+//==============================================================================
+void AudioPipeline::loadPluginFiles (juce::Array<juce::File> candidates, bool reportErrors)
+{
+    const double sr = preparedSampleRate > 0.0 ? preparedSampleRate : 44100.0;
+    const int bs = preparedBlockSize > 0 ? preparedBlockSize : 512;
+
+    loadInProgress = true;
+
+    if (onLoadStateChanged != nullptr)
+        onLoadStateChanged();
+
+    juce::WeakReference<AudioPipeline> weakThis (this);
+
+    auto applyLayout = [this] (juce::AudioPluginInstance& instance) { return routing.applyLayout (instance); };
+
+    // A second set of instances stands by for preset recalls.
+    pluginLoader.loadAsync (std::move (candidates), sr, bs, applyLayout, 2 * numPairs, [weakThis, reportErrors] (SinglePluginLoader::Result& result)
+    {
+        if (weakThis != nullptr)
+            weakThis->handleLoadResult (result, reportErrors);
+    });
+}
+
+// The built-in chain constructs in microseconds, so it skips the loader thread and goes
+// straight through the same hand-over as a loaded plugin.
+void AudioPipeline::loadBuiltIn()
+{
+    pluginLoader.cancel();
+
+    SinglePluginLoader::Result result;
+    result.sampleRate = preparedSampleRate > 0.0 ? preparedSampleRate : 44100.0;
+    result.blockSize = preparedBlockSize > 0 ? preparedBlockSize : 512;
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    for (int i = 0; i < 2 * numPairs; ++i)
+    {
+        auto instance = std::make_unique<NativeChainProcessor>();
+        result.layout = routing.applyLayout (*instance);
+        instance->setRateAndBufferSizeDetails (result.sampleRate, result.blockSize);
+        instance->prepareToPlay (result.sampleRate, result.blockSize);
+
+        if (result.instance == nullptr)
+            result.instance = std::move (instance);
+        else
+            result.siblings.push_back (std::move (instance));
+    }
+
+    result.prepareMs = 1000.0 * juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+    loadInProgress = true;
+    handleLoadResult (result, true);
+}
+
+// Plugin names in the spec are looked for where Stardust.dll is; paths are taken as given.
+void AudioPipeline::loadChain (const juce::String& specText, bool reportErrors)
+{
+    const auto spec = PluginChain::Spec::parse (specText);
+
+    if (spec.isEmpty())
+        return;
+
+    juce::Array<juce::File> files;
+
+    for (auto& member : spec.members)
+    {
+        auto locations = getPluginLocations (member);
+        auto file = locations.getFirst();
+
+        for (auto& location : locations)
+        {
+            if (location.existsAsFile())
+            {
+                file = location;
+                break;
+            }
+        }
+
+        files.add (file);
+    }
+
+    const double sr = preparedSampleRate > 0.0 ? preparedSampleRate : 44100.0;
+    const int bs = preparedBlockSize > 0 ? preparedBlockSize : 512;
+
+    loadInProgress = true;
+
+    if (onLoadStateChanged != nullptr)
+        onLoadStateChanged();
+
+    juce::WeakReference<AudioPipeline> weakThis (this);
+
+    pluginLoader.loadAllAsync (std::move (files), sr, bs, PluginChain::applyMemberLayout, 2 * numPairs,
+                               [weakThis, spec, reportErrors] (SinglePluginLoader::Result& result)
+    {
+        if (weakThis != nullptr)
+            weakThis->handleChainResult (result, spec, reportErrors);
+    });
+}
+
+// The members come back prepared, so putting them together costs no more than starting
+// each chain's workers.
+void AudioPipeline::handleChainResult (SinglePluginLoader::Result& result, const PluginChain::Spec& spec, bool reportErrors)
+{
+    // As in handleLoadResult, but before any chain gets built and prepared for nothing.
+    if (! loadInProgress)
+        return;
+
+    for (int i = 0; i < 2 * numPairs && result.members.size() == (size_t) spec.members.size(); ++i)
+    {
+        std::vector<std::unique_ptr<juce::AudioPluginInstance>> members;
+
+        for (auto& instances : result.members)
+            members.push_back (std::move (instances[(size_t) i]));
+
+        auto chain = std::make_unique<PluginChain> (spec, std::move (members), workerPool, settings.chainWorkers);
+        result.layout = routing.applyLayout (*chain);
+        chain->setRateAndBufferSizeDetails (result.sampleRate, result.blockSize);
+        chain->prepareToPlay (result.sampleRate, result.blockSize);
+
+        if (result.instance == nullptr)
+            result.instance = std::move (chain);
+        else
+            result.siblings.push_back (std::move (chain));
+    }
+
+    if (result.instance != nullptr)
+        result.layout << ", " << juce::String (result.instance->getLatencySamples()) << " smp chain latency";
+
+    result.members.clear();
+    handleLoadResult (result, reportErrors);
+}
+
+juce::Array<juce::File> AudioPipeline::getPluginLocations (const juce::String& fileName)
+{
+    if (juce::File::isAbsolutePath (fileName))
+        return { juce::File (fileName) };
+
+    const auto exe = juce::File::getSpecialLocation (juce::File::currentExecutableFile);
+
+    return { exe.getSiblingFile (fileName),
+             exe.getParentDirectory().getChildFile ("Resources").getChildFile (fileName),
+             juce::File::getCurrentWorkingDirectory().getChildFile (fileName) };
+}
+
+void AudioPipeline::handleLoadResult (SinglePluginLoader::Result& result, bool reportErrors)
+{
+    // A cancel that arrived after the loader had already finished.
+    if (! loadInProgress)
+        return;
+
+    loadInProgress = false;
+
+    // Nothing to load at startup: fall back to the built-in chain if configured to.
+    if (result.instance == nullptr && ! reportErrors && ! result.cancelled
+        && settings.builtInFallback && ! hasPlugin())
+    {
+        juce::Logger::writeToLog (getName() + ": " + result.errorMessage + " Using the built-in chain.");
+        loadBuiltIn();
+        return;
+    }
+
+    if (result.instance == nullptr)
+    {
+        awaitingManualLoad = ! hasPlugin();
+
+        if (reportErrors && ! result.cancelled && onLoadFailed != nullptr)
+            onLoadFailed (result.errorMessage);
+
+        if (onLoadStateChanged != nullptr)
+            onLoadStateChanged();
+
+        return;
+    }
+
+    juce::Logger::writeToLog (getName() + ": loaded " + (result.file != juce::File() ? result.file.getFileName() : result.instance->getName())
+                              + " in " + juce::String (result.getTotalMs(), 0) + " ms (scan "
+                              + juce::String (result.scanMs, 0) + ", construct "
+                              + juce::String (result.instantiateMs, 0) + ", prepare "
+                              + juce::String (result.prepareMs, 0) + "), " + result.layout);
+    pluginLayout = result.layout;
+
+    std::vector<std::unique_ptr<juce::AudioPluginInstance>> instances;
+    instances.push_back (std::move (result.instance));
+
+    for (auto& sibling : result.siblings)
+        instances.push_back (std::move (sibling));
+
+    jassert ((int) instances.size() == 2 * numPairs);
+
+    // The device may have been reconfigured while the load was running. If it has never
+    // started, prepareToPlay will take care of it.
+    if (preparedSampleRate > 0.0
+        && (result.sampleRate != preparedSampleRate || result.blockSize < preparedBlockSize))
+    {
+        for (auto& instance : instances)
+            prepareInstance (*instance, preparedSampleRate, preparedBlockSize);
+
+        MemoryResidency::refresh();
+    }
+
+    for (size_t pair = 0; pair < pairs.size(); ++pair)
+        pairs[pair]->standby = pairs.size() + pair < instances.size() ? std::move (instances[pairs.size() + pair]) : nullptr;
+
+    instances.resize (juce::jmin (instances.size(), pairs.size()));
+
+    pluginIdentifier = instances.front()->getPluginDescription().createIdentifierString();
+    presets.setPlugin (pluginIdentifier);
+    morph.setSnapshots (presets, instances.front()->getParameters().size());
+    midiControl.setPlugin (pluginIdentifier);
+    currentPreset = -1;
+    requestedPreset = -1;
+
+    // Whoever is showing an editor for this pipeline has to let go of the outgoing
+    // instance before it can be retired. The editor drives the first pair; parameter
+    // changes are mirrored to the others on the render side.
+    editorProcessor = instances.front().get();
+    awaitingManualLoad = false;
+
+    if (onPluginChanged != nullptr)
+        onPluginChanged();
+
+    submitInstances (std::move (instances), false);
+
+    if (onLoadStateChanged != nullptr)
+        onLoadStateChanged();
+}
+
+// Message thread. Every pair changes over on the same render block.
+void AudioPipeline::submitInstances (std::vector<std::unique_ptr<juce::AudioPluginInstance>> instances, bool recycleOutgoing)
+{
+    const auto batch = ++nextSwapBatch;
+
+    for (size_t pair = 0; pair < instances.size() && pair < pairs.size(); ++pair)
+        pairs[pair]->swap.submit (std::move (instances[pair]), batch, recycleOutgoing);
+
+    releasedSwapBatch.store (batch);
+}
+
+void AudioPipeline::storePreset (int slot)
+{
+    if (editorProcessor == nullptr)
+        return;
+
+    presets.store (slot, *editorProcessor);
+    morph.setSnapshots (presets, editorProcessor->getParameters().size());
+    currentPreset = slot;
+}
+
+void AudioPipeline::recallPreset (int slot)
+{
+    if (! hasPlugin() || ! presets.hasSnapshot (slot))
+        return;
+
+    requestedPreset = slot;
+    updatePresets();
+}
+
+void AudioPipeline::updatePresets()
+{
+    for (auto& pair : pairs)
+    {
+        pair->swap.collectRetired();
+
+        while (auto recycled = pair->swap.takeRecycled())
+        {
+            // Left over from a plugin that has since been replaced, or surplus: it is
+            // out of the audio path, so it can simply go.
+            if (pair->standby != nullptr || recycled->getPluginDescription().createIdentifierString() != pluginIdentifier)
+                continue;
+
+            // The device may have been reconfigured while it was fading out.
+            if (preparedSampleRate > 0.0
+                && (recycled->getSampleRate() != preparedSampleRate || recycled->getBlockSize() < preparedBlockSize))
+                prepareInstance (*recycled, preparedSampleRate, preparedBlockSize);
+
+            pair->standby = std::move (recycled);
+        }
+    }
+
+    if (requestedPreset < 0)
+        return;
+
+    // Until the last recall has finished fading and every standby is back, the request
+    // just waits.
+    for (auto& pair : pairs)
+        if (pair->standby == nullptr || pair->swap.isSwapping())
+            return;
+
+    const auto& snapshot = presets.getSnapshot (requestedPreset);
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    std::vector<std::unique_ptr<juce::AudioPluginInstance>> instances;
+
+    for (auto& pair : pairs)
+    {
+        pair->standby->setStateInformation (snapshot.getData(), (int) snapshot.getSize());
+        warmUp (*pair->standby);
+        instances.push_back (std::move (pair->standby));
+    }
+
+    juce::Logger::writeToLog (getName() + ": recalling preset " + PresetBank::getSlotName (requestedPreset) + ", standbys set up in "
+                              + juce::String (1000.0 * juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks), 1) + " ms");
+
+    editorProcessor = instances.front().get();
+
+    if (onPluginChanged != nullptr)
+        onPluginChanged();
+
+    submitInstances (std::move (instances), true);
+    morph.setSnapshots (presets, editorProcessor->getParameters().size());
+    currentPreset = requestedPreset;
+    requestedPreset = -1;
+}
+
+// Runs a few silent blocks through an instance outside the audio path, so it has settled
+// on its new state and touched its code and buffers before it goes live.
+void AudioPipeline::warmUp (juce::AudioPluginInstance& instance)
+{
+    const int blockSize = juce::jmin (getPluginBlockSize(), preparedBlockSize);
+
+    if (blockSize <= 0)
+        return;
+
+    juce::AudioBuffer<float> silence (juce::jmax (1, instance.getTotalNumInputChannels(), instance.getTotalNumOutputChannels()), blockSize);
+    juce::MidiBuffer midi;
+
+    for (int block = 0; block < warmUpBlocks; ++block)
+    {
+        silence.clear();
+        midi.clear();
+        instance.processBlock (silence, midi);
+    }
+
+    instance.reset();
+}
+
+juce::String AudioPipeline::startRecording()
+{
+    const auto baseName = "starnails " + getName() + " " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S");
+    auto error = recorder.start (settings.getRecordFolder(), baseName, settings.recordFormat, settings.recordInput);
+
+    if (error.isEmpty())
+        juce::Logger::writeToLog (getName() + ": " + recorder.getStatus());
+
+    return error;
+}
+
+juce::String AudioPipeline::startBufferTuning()
+{
+    if (! hasPlugin())
+        return "Load the plugin first: the tuner measures the callback with it running.";
+
+    return bufferTuner.start();
+}
+
+void AudioPipeline::cancelLoad()
+{
+    pluginLoader.cancel();
+    loadInProgress = false;
+    awaitingManualLoad = ! hasPlugin();
+
+    if (onLoadStateChanged != nullptr)
+        onLoadStateChanged();
+}
+
+void AudioPipeline::postParameterChange (juce::AudioProcessorParameter& param, float value)
+{
+    if (! parameterScheduler.post (param.getParameterIndex(), value))
+        param.setValueNotifyingHost (value);
+}
+
+void AudioPipeline::postParameterGesture (juce::AudioProcessorParameter& param, bool starting)
+{
+    if (parameterScheduler.postGesture (param.getParameterIndex(), starting))
+        return;
+
+    if (starting)
+        param.beginChangeGesture();
+    else
+        param.endChangeGesture();
+}
+
+void AudioPipeline::dispatchParameterNotifications()
+{
+    parameterScheduler.dispatchApplied ([this] (const ParameterScheduler::Change& change)
+    {
+        if (editorProcessor == nullptr)
+            return;
+
+        const auto& params = editorProcessor->getParameters();
+
+        if (! juce::isPositiveAndBelow (change.parameterIndex, params.size()))
+            return;
+
+        auto* param = params.getUnchecked (change.parameterIndex);
+
+        switch (change.kind)
+        {
+            case ParameterScheduler::Kind::value:          param->sendValueChangedMessageToListeners (change.value); break;
+            case ParameterScheduler::Kind::beginGesture:   param->beginChangeGesture(); break;
+            case ParameterScheduler::Kind::endGesture:     param->endChangeGesture(); break;
+        }
+    });
+
+    // The morph sets values on the render side without telling anyone; catch the
+    // listeners up with whatever it moved.
+    if (! morph.takeChanged() || editorProcessor == nullptr)
+        return;
+
+    const auto& params = editorProcessor->getParameters();
+    morphNotified.resize ((size_t) params.size(), -1.0f);
+
+    for (int i = 0; i < params.size(); ++i)
+    {
+        auto* param = params.getUnchecked (i);
+        const float value = param->getValue();
+
+        if (value != morphNotified[(size_t) i])
+        {
+            morphNotified[(size_t) i] = value;
+            param->sendValueChangedMessageToListeners (value);
+        }
+    }
+}
+
+juce::StringArray AudioPipeline::getStatusItems() const
+{
+    juce::StringArray items;
+
+    auto tuning = bufferTuner.getStatus();
+
+    if (tuning.isNotEmpty())
+        items.add (tuning);
+
+    if (recorder.isRecording())
+        items.add (recorder.getStatus());
+
+    if (inputBridge.isOpen())
+        items.add (inputBridge.getStatus());
+
+    if (midiControl.isOpen())
+        items.add (midiControl.isLearning() ? juce::String ("MIDI learn: move a controller")
+                                            : "MIDI " + midiControl.getDeviceName() + ", " + juce::String (midiControl.getNumMappings())
+                                                  + " mapped, " + juce::String (midiControl.getMappedCount()) + " applied");
+
+    if (anticipativeRenderer.isRunning())
+        items.add ("Lookahead " + juce::String (anticipativeRenderer.getLatencySamples()) + " smp, "
+                   + juce::String (anticipativeRenderer.getUnderrunCount()) + " underruns");
+
+    if (reblocker.isActive())
+        items.add ("Block " + juce::String (reblocker.getBlockSize()) + " (+"
+                   + juce::String (reblocker.getLatencySamples()) + " smp)");
+
+    if (silenceGate.isIdle())
+        items.add ("Idle (silent input)");
+
+    if (watchdog.isProtectingNow())
+        items.add ("Watchdog: plugin bypassed for overload, retry in " + juce::String (watchdog.getLastTrip().backoffMs / 1000.0, 1) + " s");
+    else if (watchdog.getTripCount() > 0)
+        items.add ("Watchdog: " + juce::String (watchdog.getTripCount()) + " overloads");
+
+    if (bypassEnabled.load())
+    {
+        auto& bypass = pairs.front()->bypass;
+        items.add (bypass.isUsingNativeBypass() ? juce::String ("Bypass: native")
+                                                : "Bypass: dry +" + juce::String (bypass.getCompensationSamples()) + " smp");
+    }
+
+    if (outputGuard.getNonFiniteCount() > 0 || outputGuard.getDenormalCount() > 0)
+        items.add ("Guard " + juce::String (outputGuard.getNonFiniteCount()) + " NaN/Inf, "
+                   + juce::String (outputGuard.getDenormalCount()) + " denormal blocks");
+
+    if (audioFaults.getMajorFaults() > 0 || audioFaults.getMinorFaults() > 0)
+        items.add ("Page faults " + juce::String (audioFaults.getMajorFaults()) + " major, "
+                   + juce::String (audioFaults.getMinorFaults()) + " minor");
+
+    if (currentPreset >= 0 || requestedPreset >= 0)
+        items.add ("Preset " + PresetBank::getSlotName (requestedPreset >= 0 ? requestedPreset : currentPreset)
+                   + (requestedPreset >= 0 ? " (switching)" : ""));
+
+    if (parameterLatency.numChanges > 0)
+        items.add ("Param latency " + juce::String (parameterLatency.averageMs, 1) + " ms avg, "
+                   + juce::String (parameterLatency.maxMs, 1) + " max, "
+                   + juce::String (parameterScheduler.getCoalescedCount()) + " coalesced, "
+                   + juce::String (parameterScheduler.getDroppedCount()) + " dropped");
+
+    if (routing.getNumSidechainChannels() > 0 || routing.getNumAuxChannels() > 0)
+        items.add ("Routing: " + (pluginLayout.isNotEmpty() ? pluginLayout : juce::String ("no plugin")));
+
+    if (auto* chain = dynamic_cast<PluginChain*> (editorProcessor))
+        items.add ("Chain: " + juce::String (chain->getNumMembers()) + " plugins, +" + juce::String (chain->getLatencySamples())
+                   + " smp" + (chain->getMaxBranches() > 1 ? ", branches on " + juce::String (chain->getNumThreads()) + " threads" : juce::String()));
+
+    if (numPairs > 1)
+        items.add (juce::String (numPairs) + " pairs on " + juce::String (workerPool.getNumWorkers() + 1) + " threads");
+
+    return items;
+}
+
+void AudioPipeline::pollDiagnostics()
+{
+    const int nonFinite = outputGuard.getNonFiniteCount();
+    const int denormal = outputGuard.getDenormalCount();
+
+    if (nonFinite != loggedNonFinite)
+        juce::Logger::writeToLog (getName() + ": muted " + juce::String (nonFinite - loggedNonFinite)
+                                  + " plugin output blocks containing NaN/Inf (" + juce::String (nonFinite) + " total)");
+
+    if (denormal != loggedDenormal)
+        juce::Logger::writeToLog (getName() + ": flushed denormals in " + juce::String (denormal - loggedDenormal)
+                                  + " plugin output blocks (" + juce::String (denormal) + " total)");
+
+    loggedNonFinite = nonFinite;
+    loggedDenormal = denormal;
+
+    const auto majorFaults = audioFaults.getMajorFaults();
+    const auto minorFaults = audioFaults.getMinorFaults();
+
+    if (majorFaults != loggedMajorFaults || minorFaults != loggedMinorFaults)
+        juce::Logger::writeToLog (getName() + ": audio thread took " + juce::String (majorFaults - loggedMajorFaults) + " major and "
+                                  + juce::String (minorFaults - loggedMinorFaults) + " minor page faults ("
+                                  + juce::String (majorFaults) + " / " + juce::String (minorFaults) + " this session)");
+
+    loggedMajorFaults = majorFaults;
+    loggedMinorFaults = minorFaults;
+
+    const int inputResyncs = inputBridge.getResyncCount();
+    const int inputDrops = inputBridge.getDroppedCount();
+
+    if (inputResyncs != loggedInputResyncs || inputDrops != loggedInputDrops)
+        juce::Logger::writeToLog (getName() + ": input device resynchronised " + juce::String (inputResyncs - loggedInputResyncs)
+                                  + " times, dropped " + juce::String (inputDrops - loggedInputDrops) + " capture blocks ("
+                                  + inputBridge.getStatus() + ")");
+
+    loggedInputResyncs = inputResyncs;
+    loggedInputDrops = inputDrops;
+
+    // The last poll that saw any changes stays on show.
+    const auto latency = parameterScheduler.takeLatency();
+
+    if (latency.numChanges > 0)
+        parameterLatency = latency;
+
+    const int coalesced = parameterScheduler.getCoalescedCount();
+
+    if (coalesced != loggedCoalesced)
+        juce::Logger::writeToLog (getName() + ": coalesced " + juce::String (coalesced - loggedCoalesced)
+                                  + " parameter updates into later ones (" + juce::String (coalesced) + " total)");
+
+    loggedCoalesced = coalesced;
+
+    const int parametersDropped = parameterScheduler.getDroppedCount();
+
+    if (parametersDropped != loggedParametersDropped)
+        juce::Logger::writeToLog (getName() + ": dropped " + juce::String (parametersDropped - loggedParametersDropped)
+                                  + " parameter updates, the render side fell behind (" + juce::String (parametersDropped) + " total)");
+
+    loggedParametersDropped = parametersDropped;
+
+    const int midiDropped = midiControl.getDroppedCount();
+
+    if (midiDropped != loggedMidiDropped)
+        juce::Logger::writeToLog (getName() + ": dropped " + juce::String (midiDropped - loggedMidiDropped)
+                                  + " incoming MIDI messages (" + juce::String (midiDropped) + " total)");
+
+    loggedMidiDropped = midiDropped;
+
+    const int recordDropped = recorder.getDroppedCount();
+
+    if (recordDropped != loggedRecordDropped)
+        juce::Logger::writeToLog (getName() + ": the disk fell behind, " + juce::String (recordDropped - loggedRecordDropped)
+                                  + " blocks missing from the recording (" + juce::String (recordDropped) + " total)");
+
+    loggedRecordDropped = recordDropped;
+
+    const int trips = watchdog.getTripCount();
+    const int retries = watchdog.getRetryCount();
+
+    if (trips != loggedWatchdogTrips)
+    {
+        const auto trip = watchdog.getLastTrip();
+        juce::Logger::writeToLog (getName() + ": CPU watchdog tripped: plugin took " + juce::String (juce::roundToInt (trip.averageLoad * 100.0f))
+                                  + "% of the block on average (peak " + juce::String (juce::roundToInt (trip.peakLoad * 100.0f)) + "%) over "
+                                  + juce::String (trip.numBlocks) + " blocks of " + juce::String (trip.blockMs, 1)
+                                  + " ms; dry path for " + juce::String (trip.backoffMs) + " ms (" + juce::String (trips) + " trips)");
+    }
+
+    if (retries != loggedWatchdogRetries)
+        juce::Logger::writeToLog (getName() + ": CPU watchdog letting the plugin back in (" + juce::String (retries) + " retries)");
+
+    loggedWatchdogTrips = trips;
+    loggedWatchdogRetries = retries;
+}
+
+//==============================================================================
+void AudioPipeline::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    currentBlockSize = samplesPerBlockExpected;
+
+    // Plugins stay prepared across device restarts. They only go through release and
+    // prepare again when the rate changes or the new block size is more than they were
+    // prepared for, which is what makes touching the audio settings glitch.
+    const bool pluginsNeedPrepare = sampleRate != preparedSampleRate || getPluginBlockSize() > preparedBlockSize;
+
+    if (pluginsNeedPrepare)
+    {
+        preparedBlockSize = chooseMaxBlockSize();
+        preparedSampleRate = sampleRate;
+    }
+
+    if (! autoLoadAttempted)
+    {
+        autoLoadAttempted = true;
+
+        // Don't hold up the device start for the plugin's constructor.
+        if (PluginChain::Spec::parse (settings.chain).isEmpty())
+            loadPluginFiles (getPluginLocations ("Stardust.dll"), false);
+        else
+            loadChain (settings.chain, false);
+    }
+
+    // A restarted device may call us back on a different thread.
+    callbackPinned = false;
+    audioFaults.restart();
+    loadMonitor.prepare (sampleRate);
+    inputBridge.prepare (sampleRate, juce::jmax (samplesPerBlockExpected, maxPreparedBlockSize), settings.inputLatencyMs);
+
+    deviceSamplePosition = 0;
+    renderSamplePosition = 0;
+    parameterScheduler.reset();
+    midiControl.reset();
+    segmentMidi.ensureSize (midiBufferBytes);
+
+    if (recorder.prepare (numChannels, sampleRate, juce::jmax (samplesPerBlockExpected, maxPreparedBlockSize), settings.recordBufferSeconds))
+        juce::Logger::writeToLog (getName() + ": recording stopped, the device changed sample rate");
+    reblocker.prepare (routing.getNumRenderChannels(), settings.fixedBlockSize, samplesPerBlockExpected);
+
+    const int bypassFadeSamples = juce::roundToInt (sampleRate * settings.bypassFadeMs / 1000.0);
+    const auto prepareStartTicks = juce::Time::getHighResolutionTicks();
+
+    for (auto& pair : pairs)
+    {
+        if (pluginsNeedPrepare)
+        {
+            pair->swap.prepareToPlay (preparedBlockSize, ChannelRouting::maxPluginChannels, [this] (juce::AudioPluginInstance& p)
+            {
+                prepareInstance (p, preparedSampleRate, preparedBlockSize);
+            });
+
+            routing.prepareScratch (pair->routeScratch, preparedBlockSize);
+            pair->midi.ensureSize (midiBufferBytes);
+
+            if (pair->standby != nullptr)
+                prepareInstance (*pair->standby, preparedSampleRate, preparedBlockSize);
+        }
+
+        pair->bypass.prepare (2, preparedBlockSize, bypassFadeSamples);
+    }
+
+    if (hasPlugin())
+        juce::Logger::writeToLog (getName() + ": device at " + juce::String (sampleRate) + " Hz / "
+                                  + juce::String (samplesPerBlockExpected) + " smp, "
+                                  + (pluginsNeedPrepare ? "plugin prepared for " + juce::String (preparedBlockSize) + " smp in "
+                                                              + juce::String (1000.0 * juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - prepareStartTicks), 1) + " ms"
+                                                        : "plugin kept prepared for " + juce::String (preparedBlockSize) + " smp"));
+
+    // A chain's parallel branches borrow the same workers when the pairs leave them free, so
+    // the startup chain has a say in how many there are; never more than the cores allow.
+    const int chainBranchWorkers = juce::jmin (PluginChain::Spec::parse (settings.chain).getMaxBranches() - 1,
+                                               settings.chainWorkers >= 0 ? settings.chainWorkers : settings.getMaxWorkerThreads());
+    workerPool.start (juce::jmin (settings.getMaxWorkerThreads(), juce::jmax (settings.getNumWorkerThreads(), chainBranchWorkers)),
+                      sampleRate, getPluginBlockSize(), settings.getWorkerCores (index));
+    silenceGate.prepare (sampleRate, settings.silenceThresholdDb, settings.silenceHoldMs);
+    watchdog.prepare (sampleRate, settings.watchdogPercent, settings.watchdogBlocks, settings.watchdogRetryMs);
+
+    if (settings.lookaheadBlocks > 0)
+        anticipativeRenderer.start (sampleRate, routing.getNumRenderChannels(), samplesPerBlockExpected, settings.lookaheadBlocks,
+                                    [this] (juce::AudioBuffer<float>& block) { renderStages (block); });
+
+    // The plugins have just been prepared again and may have allocated.
+    if (pluginsNeedPrepare)
+        MemoryResidency::refresh();
+}
+
+int AudioPipeline::getPluginBlockSize() const noexcept
+{
+    return settings.fixedBlockSize > 0 ? settings.fixedBlockSize : currentBlockSize;
+}
+
+// Prepares for the largest period the device offers (within reason) rather than the
+// current one, so later changes to a smaller or moderately larger period need nothing.
+int AudioPipeline::chooseMaxBlockSize()
+{
+    int size = getPluginBlockSize();
+
+    if (settings.fixedBlockSize > 0)
+        return size;
+
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        for (auto available : device->getAvailableBufferSizes())
+            if (available <= maxPreparedBlockSize)
+                size = juce::jmax (size, available);
+
+    return juce::jmax (size, preparedSampleRate == currentSampleRate ? preparedBlockSize : 0);
+}
+
+// Message thread. The bus layout can only change while the instance is released.
+void AudioPipeline::prepareInstance (juce::AudioPluginInstance& instance, double sampleRate, int blockSize)
+{
+    instance.releaseResources();
+    routing.applyLayout (instance);
+    instance.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    instance.prepareToPlay (sampleRate, blockSize);
+}
+
+void AudioPipeline::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    juce::ScopedNoDenormals noDenormals;
+    const auto callbackStart = loadMonitor.begin();
+
+    if (! callbackPinned)
+    {
+        callbackPinned = true;
+        RealtimeScheduling::applyToCurrentThread (RealtimeScheduling::Role::audio, settings.getPipelineCore (index));
+        MemoryResidency::prefaultStack();
+        audioFaults.sample();
+    }
+
+    // Pulled even with no plugin loaded, so the capture stays locked to our clock.
+    if (inputBridge.isOpen())
+        inputBridge.read (*bufferToFill.buffer, bufferToFill.buffer->getNumSamples());
+
+    recorder.captureInput (*bufferToFill.buffer, bufferToFill.buffer->getNumSamples());
+
+    if (pairs.front()->swap.hasInstance())
+    {
+        auto* buffer = bufferToFill.buffer;
+        const int numSamples = buffer->getNumSamples();
+
+        // The device may have opened fewer channels than we asked for.
+        const int numMetered = juce::jmin (numChannels, buffer->getNumChannels());
+
+        // The buffer tuner's synthetic load: keep the plugin busy whatever the room is doing.
+        const bool synthetic = syntheticLoad.load();
+
+        if (synthetic)
+            for (int ch = 0; ch < numMetered; ++ch)
+                for (auto* sample = buffer->getWritePointer (ch), *end = sample + numSamples; sample != end; ++sample)
+                    *sample = (noise.nextFloat() * 2.0f - 1.0f) * 0.25f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            rmsInput[(size_t) ch].store (ch < numMetered ? buffer->getRMSLevel (ch, 0, numSamples) : 0.0f);
+
+        // Mapped controllers join this callback's parameter batch, so they go first.
+        midiControl.schedule (deviceSamplePosition, numSamples, currentSampleRate, parameterScheduler);
+        parameterScheduler.schedule (deviceSamplePosition, numSamples, currentSampleRate);
+        deviceSamplePosition += numSamples;
+
+        if (anticipativeRenderer.isRunning())
+            anticipativeRenderer.process (*buffer);
+        else
+            renderStages (*buffer);
+
+        // Nobody wants to hear the tuner's noise.
+        if (synthetic)
+            bufferToFill.clearActiveBufferRegion();
+
+        float maxOut = 0.0f;
+        float sumOut = 0.0f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float rmsOut = ch < numMetered ? buffer->getRMSLevel (ch, 0, numSamples) : 0.0f;
+            rmsOutput[(size_t) ch].store (rmsOut);
+            maxOut = juce::jmax (maxOut, rmsOut);
+            sumOut += rmsOut;
+        }
+
+        tonalEnergy.store (juce::jlimit (0.0f, 1.0f, maxOut * 2.0f));
+
+        const float envelope = sumOut / (float) juce::jmax (1, numMetered);
+        const float delta = juce::jmax (0.0f, envelope - prevEnergy);
+        prevEnergy = envelope * 0.9f + prevEnergy * 0.1f;
+        rhythmEnergy.store (juce::jlimit (0.0f, 1.0f, delta * 8.0f));
+
+        if (auto* scope = scopeTarget.load())
+            if (numMetered > 0)
+                scope->pushSamples (buffer->getArrayOfReadPointers(), numMetered, numSamples);
+    }
+    else
+    {
+        bufferToFill.clearActiveBufferRegion();
+        midiControl.discardArrivals();
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            rmsInput[(size_t) ch].store (0.0f);
+            rmsOutput[(size_t) ch].store (0.0f);
+        }
+
+        tonalEnergy.store (0.0f);
+        rhythmEnergy.store (0.0f);
+        prevEnergy = 0.0f;
+    }
+
+    // Whatever actually goes out, silence included.
+    recorder.push (*bufferToFill.buffer, bufferToFill.buffer->getNumSamples());
+
+    audioFaults.sample();
+    loadMonitor.end (callbackStart, bufferToFill.numSamples);
+}
+
+// Everything between the device buffer and the plugin. Runs either straight from the
+// device callback or one block ahead on the DSP worker.
+void AudioPipeline::renderStages (juce::AudioBuffer<float>& buffer)
+{
+    if (reblocker.isActive())
+        reblocker.process (buffer, [this] (juce::AudioBuffer<float>& block) { renderBlock (block); });
+    else
+        renderBlock (buffer);
+}
+
+void AudioPipeline::renderBlock (juce::AudioBuffer<float>& buffer)
+{
+    const auto blockPosition = renderSamplePosition;
+    renderSamplePosition += buffer.getNumSamples();
+
+    const auto releasedBatch = releasedSwapBatch.load();
+
+    for (auto& pair : pairs)
+        pair->swap.beginBlock (releasedBatch);
+
+    // All pairs are loaded together, so the first one speaks for the rest.
+    if (pairs.front()->swap.getActive() == nullptr)
+    {
+        buffer.clear();
+        return;
+    }
+
+    auto getTailSeconds = [this]
+    {
+        double tail = 0.0;
+
+        for (auto& pair : pairs)
+            if (auto* active = pair->swap.getActive())
+                tail = juce::jmax (tail, active->getTailLengthSeconds());
+
+        return tail;
+    };
+
+    const bool pluginNeeded = silenceGate.beginBlock (buffer, getTailSeconds);
+    juce::int64 pluginTicks = 0;
+
+    auto applyChange = [this] (int parameterIndex, float value)
+    {
+        for (auto& pair : pairs)
+        {
+            if (auto* active = pair->swap.getActive())
+            {
+                const auto& params = active->getParameters();
+
+                // Listeners hear about it from the message thread, in dispatchParameterNotifications.
+                if (juce::isPositiveAndBelow (parameterIndex, params.size()))
+                    params.getUnchecked (parameterIndex)->setValue (value);
+            }
+        }
+    };
+
+    morph.process (applyChange);
+
+    // The plugin keeps running while bypassed, so changes split the block either way.
+    // While the gate is idle they are still applied, the segments just stay silent.
+    auto segmentPosition = blockPosition;
+
+    parameterScheduler.process (buffer, blockPosition, applyChange, [this, pluginNeeded, &pluginTicks, &segmentPosition] (juce::AudioBuffer<float>& segment)
+    {
+        // Taken even while idle, so stale events don't pile up for later.
+        midiControl.collect (segmentPosition, segment.getNumSamples(), segmentMidi);
+        segmentPosition += segment.getNumSamples();
+
+        if (! pluginNeeded)
+        {
+            segment.clear();
+            return;
+        }
+
+        const bool protective = watchdog.isProtecting();
+        const bool shouldBypass = bypassEnabled.load() || protective;
+
+        auto renderPair = [this, &segment, shouldBypass, protective] (int pairIndex)
+        {
+            // FTZ/DAZ are per thread, and this may be running on a pool worker.
+            juce::ScopedNoDenormals noDenormals;
+            auto& pair = *pairs[(size_t) pairIndex];
+            juce::AudioBuffer<float> pairView (segment.getArrayOfWritePointers() + 2 * pairIndex, 2, segment.getNumSamples());
+
+            auto* active = pair.swap.getActive();
+
+            if (active == nullptr)
+            {
+                pairView.clear();
+                return;
+            }
+
+            // Each instance gets its own copy; plugins are free to rewrite the buffer.
+            pair.midi.clear();
+            pair.midi.addEvents (segmentMidi, 0, -1, 0);
+
+            pair.bypass.process (pairView, *active, shouldBypass, protective, [this, &pair, &segment, pairIndex, active] (juce::AudioBuffer<float>& block)
+            {
+                routing.process (block, segment, pairIndex, *active, pair.routeScratch,
+                                 [&pair] (juce::AudioBuffer<float>& view) { pair.swap.process (view, pair.midi); },
+                                 [this] (juce::AudioBuffer<float>& aux) { outputGuard.process (aux); });
+            });
+
+            // The bypass only has a dry signal for the main pair; aux fades out with the plugin.
+            routing.applyAuxGain (segment, pairIndex, pair.bypass.getPluginGainStart(), pair.bypass.getPluginGainEnd());
+            outputGuard.process (pairView);
+        };
+
+        // Pairs the device has no channels for are skipped.
+        const auto pluginStart = juce::Time::getHighResolutionTicks();
+        workerPool.run (juce::jmin (numPairs, segment.getNumChannels() / 2), renderPair);
+        pluginTicks += juce::Time::getHighResolutionTicks() - pluginStart;
+
+        routing.clearUnroutedOutputs (segment);
+    });
+
+    watchdog.endBlock (pluginTicks, buffer.getNumSamples());
+
+    if (pluginNeeded)
+        silenceGate.endBlock (buffer);
+}
+
+// The plugins are left prepared; prepareToPlay decides whether they need it again.
+void AudioPipeline::releaseResources()
+{
+    anticipativeRenderer.stop();
+    workerPool.stop();
+}
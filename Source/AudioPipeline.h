@@ -0,0 +1,251 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SinglePluginLoader.h"
+#include "PluginHotSwap.h"
+#include "PluginBypass.h"
+#include "AnticipativeRenderer.h"
+#include "Reblocker.h"
+#include "ParameterScheduler.h"
+#include "RealtimeWorkerPool.h"
+#include "SilenceGate.h"
+#include "OutputGuard.h"
+#include "CpuWatchdog.h"
+#include "ChannelRouting.h"
+#include "CallbackLoadMonitor.h"
+#include "BufferSizeTuner.h"
+#include "AsyncInputBridge.h"
+#include "PresetBank.h"
+#include "PresetMorph.h"
+#include "MidiControl.h"
+#include "NativeChainProcessor.h"
+#include "PluginChain.h"
+#include "DiskRecorder.h"
+#include "EngineSettings.h"
+#include "RealtimeScheduling.h"
+#include "MemoryResidency.h"
+#include "MeterComponents.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/*
+    One complete audio path: its own device, plugin instances, render stages and meter
+    feeds. The process can host several of these side by side; the UI only ever looks
+    at one of them at a time.
+
+    The device's channels are split into stereo pairs, each with its own instance of the
+    plugin, and the pairs are rendered in parallel on a real-time worker pool. Further
+    device channels can feed the instances' sidechains and carry their extra outputs.
+    The input can also come from a second device, resampled onto this one's clock.
+*/
+class AudioPipeline  : public juce::AudioSource,
+                       private juce::ChangeListener
+{
+public:
+    AudioPipeline (int pipelineIndex, const EngineSettings& engineSettings);
+    ~AudioPipeline() override;
+
+    //==============================================================================
+    void start (int numInputChannels, int numOutputChannels);
+    void shutdown();
+
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    //==============================================================================
+    // Message thread.
+    void loadPluginFiles (juce::Array<juce::File> candidates, bool reportErrors);
+    void loadBuiltIn();
+    void loadChain (const juce::String& spec, bool reportErrors);
+    void cancelLoad();
+    bool isLoadInProgress() const noexcept              { return loadInProgress; }
+    bool isAwaitingManualLoad() const noexcept          { return awaitingManualLoad && ! loadInProgress; }
+    const SinglePluginLoader& getLoader() const noexcept { return pluginLoader; }
+    bool hasPlugin() const noexcept                     { return editorProcessor != nullptr; }
+    juce::AudioProcessor* getEditorProcessor() const noexcept { return editorProcessor; }
+
+    void postParameterChange (juce::AudioProcessorParameter& param, float value);
+    void postParameterGesture (juce::AudioProcessorParameter& param, bool starting);
+
+    // Message thread, frequently. Tells the editor instance's listeners about the
+    // changes and gestures the audio side has applied.
+    void dispatchParameterNotifications();
+
+    // Preset snapshots of the plugin's state. A recall changes every pair over on the
+    // same block, crossfading to standby instances that were set up beforehand, so the
+    // device callback never sees setStateInformation.
+    void storePreset (int slot);
+    void recallPreset (int slot);
+    bool hasPreset (int slot) const noexcept            { return presets.hasSnapshot (slot); }
+    int getCurrentPreset() const noexcept               { return currentPreset; }
+
+    // Message thread, frequently. Destroys the instances the render thread has let go of,
+    // takes back the ones a recall replaced as the next standbys, and carries out a recall
+    // once they are ready.
+    void updatePresets();
+
+    // Glides between the preset snapshots from a pad position; see PresetMorph.
+    void setMorphPosition (float x, float y) noexcept   { morph.setPosition (x, y); }
+    bool canMorph() const noexcept                      { return hasPlugin() && morph.canMorph(); }
+    juce::Point<float> getMorphPosition() const noexcept { return { morph.getX(), morph.getY() }; }
+
+    // MIDI learn: the next controller moved on the pipeline's MIDI input is mapped to
+    // this parameter. updateMidiLearn returns true once that has happened.
+    bool hasMidiInput() const noexcept                  { return midiControl.isOpen(); }
+    void learnMidi (juce::AudioProcessorParameter& param) { midiControl.learn (param.getParameterIndex()); }
+    void cancelMidiLearn()                              { midiControl.cancelLearn(); }
+    bool isLearningMidi() const noexcept                { return midiControl.isLearning(); }
+    bool updateMidiLearn()                              { return midiControl.updateLearn(); }
+
+    // Records what goes to the device, plus the raw input if configured, to files in
+    // the record folder. startRecording returns an error message on failure.
+    juce::String startRecording();
+    void stopRecording()                                { recorder.stop(); }
+    bool isRecording() const noexcept                   { return recorder.isRecording(); }
+
+    void setBypass (bool shouldBypass) noexcept         { bypassEnabled.store (shouldBypass); }
+    bool isBypassed() const noexcept                    { return bypassEnabled.load(); }
+
+    // True while the silence gate has the plugin idled.
+    bool isIdle() const noexcept                        { return silenceGate.isIdle(); }
+
+    juce::AudioDeviceManager& getDeviceManager() noexcept { return deviceManager; }
+
+    // Steps the device through its buffer sizes and keeps the smallest safe one. Returns
+    // an error message if tuning can't start.
+    juce::String startBufferTuning();
+    void cancelBufferTuning()                           { bufferTuner.cancel(); }
+    bool isTuningBuffer() const noexcept                { return bufferTuner.isRunning(); }
+    juce::String getBufferTuningStatus() const          { return bufferTuner.getStatus(); }
+
+    juce::String getName() const                        { return "Zone " + juce::String (index + 1); }
+    juce::StringArray getStatusItems() const;
+
+    // Message thread, every so often. Logs anything the audio side has counted since
+    // the last call.
+    void pollDiagnostics();
+
+    // The oscilloscope fed by this pipeline's callback, or nullptr while it isn't shown.
+    void setScope (OscilloscopeComponent* scope) noexcept { scopeTarget.store (scope); }
+
+    int getNumChannels() const noexcept                 { return numChannels; }
+    float getInputLevel (int channel) const noexcept    { return rmsInput[(size_t) channel].load(); }
+    float getOutputLevel (int channel) const noexcept   { return rmsOutput[(size_t) channel].load(); }
+    float getTonalEnergy() const noexcept               { return tonalEnergy.load(); }
+    float getRhythmEnergy() const noexcept              { return rhythmEnergy.load(); }
+
+    // Message thread callbacks.
+    std::function<void()> onPluginChanged;
+    std::function<void (const juce::String&)> onLoadFailed;
+    std::function<void()> onLoadStateChanged;
+
+private:
+    void changeListenerCallback (juce::ChangeBroadcaster*) override;
+    void handleLoadResult (SinglePluginLoader::Result& result, bool reportErrors);
+    void handleChainResult (SinglePluginLoader::Result& result, const PluginChain::Spec& spec, bool reportErrors);
+    static juce::Array<juce::File> getPluginLocations (const juce::String& fileName);
+    void renderStages (juce::AudioBuffer<float>& buffer);
+    void renderBlock (juce::AudioBuffer<float>& buffer);
+    int getPluginBlockSize() const noexcept;
+    int chooseMaxBlockSize();
+    void prepareInstance (juce::AudioPluginInstance& instance, double sampleRate, int blockSize);
+    void warmUp (juce::AudioPluginInstance& instance);
+    void submitInstances (std::vector<std::unique_ptr<juce::AudioPluginInstance>> instances, bool recycleOutgoing);
+    juce::String getDeviceStateKey() const              { return "pipeline" + juce::String (index) + ".device"; }
+
+    const int index;
+    const EngineSettings& settings;
+    const int numChannels;
+    const int numPairs;
+
+    juce::AudioDeviceManager deviceManager;
+    juce::AudioSourcePlayer sourcePlayer;
+    CallbackLoadMonitor loadMonitor;
+    BufferSizeTuner bufferTuner { deviceManager, loadMonitor, settings, "pipeline" + juce::String (index) + ".tuning" };
+    std::atomic<bool> syntheticLoad { false };
+    juce::Random noise;                     // device callback only
+    AsyncInputBridge inputBridge;
+    int loggedInputResyncs = 0;
+    int loggedInputDrops = 0;
+
+    // Before the loader, whose thread uses it.
+    ChannelRouting routing;
+    juce::String pluginLayout;
+
+    SinglePluginLoader pluginLoader;
+    // One plugin instance per stereo pair.
+    struct ChannelPair
+    {
+        PluginHotSwap swap;
+        PluginBypass bypass;
+        juce::AudioBuffer<float> routeScratch;
+        juce::MidiBuffer midi;                                  // render side
+        std::unique_ptr<juce::AudioPluginInstance> standby;    // message thread
+    };
+
+    std::vector<std::unique_ptr<ChannelPair>> pairs;
+    RealtimeWorkerPool workerPool;
+    AnticipativeRenderer anticipativeRenderer;
+    Reblocker reblocker;
+    ParameterScheduler parameterScheduler;
+    SilenceGate silenceGate;
+    OutputGuard outputGuard;
+    CpuWatchdog watchdog;
+    int loggedWatchdogTrips = 0;
+    int loggedWatchdogRetries = 0;
+    int loggedNonFinite = 0;
+    int loggedDenormal = 0;
+    MemoryResidency::FaultCounter audioFaults;  // the device callback thread
+    juce::int64 loggedMajorFaults = 0;
+    juce::int64 loggedMinorFaults = 0;
+    ParameterScheduler::Latency parameterLatency;
+    int loggedCoalesced = 0;
+    int loggedParametersDropped = 0;
+    MidiControl midiControl { "pipeline" + juce::String (index) + ".midimap" };
+    juce::MidiBuffer segmentMidi;           // render thread only
+    int loggedMidiDropped = 0;
+    DiskRecorder recorder;
+    int loggedRecordDropped = 0;
+    juce::int64 deviceSamplePosition = 0;   // device callback only
+    juce::int64 renderSamplePosition = 0;   // render thread only
+    std::atomic<bool> bypassEnabled { false };
+    bool callbackPinned = false;            // device callback only
+
+    double currentSampleRate = 0.0;
+    int currentBlockSize = 0;
+
+    // What the plugin instances are currently prepared for. Message thread.
+    static constexpr int maxPreparedBlockSize = 4096;
+    static constexpr int warmUpBlocks = 4;
+    static constexpr int midiBufferBytes = 4096;
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+    bool autoLoadAttempted = false;
+    bool loadInProgress = false;
+    bool awaitingManualLoad = false;
+    juce::AudioProcessor* editorProcessor = nullptr;
+    juce::String pluginIdentifier;
+
+    PresetBank presets { "pipeline" + juce::String (index) + ".presets" };
+    int currentPreset = -1;
+    int requestedPreset = -1;
+    PresetMorph morph;
+    std::vector<float> morphNotified;   // message thread
+
+    // Instances submitted together are released to the render side in one go.
+    juce::uint32 nextSwapBatch = 0;
+    std::atomic<juce::uint32> releasedSwapBatch { 0 };
+
+    std::atomic<float> tonalEnergy { 0.0f };
+    std::atomic<float> rhythmEnergy { 0.0f };
+    float prevEnergy = 0.0f;
+    std::vector<std::atomic<float>> rmsInput;
+    std::vector<std::atomic<float>> rmsOutput;
+    std::atomic<OscilloscopeComponent*> scopeTarget { nullptr };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (AudioPipeline)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPipeline)
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioPipeline.h"
+#include "EngineSettings.h"
+
+// Contents of the audio settings dialog: JUCE's device selector for one pipeline, plus
+// the buffer-size tuner's button and its progress or outcome.
+class AudioSettingsPanel  : public juce::Component,
+                            private juce::Timer
+{
+public:
+    AudioSettingsPanel (AudioPipeline& p, const EngineSettings& settings)
+        : pipeline (&p),
+          selector (p.getDeviceManager(),
+                    0, settings.getNumDeviceInputs(),   // min/max inputs
+                    0, settings.getNumDeviceOutputs(),  // min/max outputs
+                    true, true, true, false)
+    {
+        addAndMakeVisible (selector);
+        addAndMakeVisible (tuneButton);
+        addAndMakeVisible (tuneStatus);
+        tuneStatus.setJustificationType (juce::Justification::centredLeft);
+
+        tuneButton.onClick = [this] { toggleTuning(); };
+
+        startTimerHz (4);
+        timerCallback();
+        setSize (500, 440);
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds();
+        auto tuneRow = area.removeFromBottom (40).reduced (10, 6);
+
+        tuneButton.setBounds (tuneRow.removeFromLeft (150));
+        tuneStatus.setBounds (tuneRow.withTrimmedLeft (10));
+        selector.setBounds (area);
+    }
+
+private:
+    void toggleTuning()
+    {
+        if (pipeline == nullptr)
+            return;
+
+        if (pipeline->isTuningBuffer())
+        {
+            pipeline->cancelBufferTuning();
+        }
+        else
+        {
+            auto error = pipeline->startBufferTuning();
+
+            if (error.isNotEmpty())
+            {
+                errorText = error;
+                errorCountdown = 16;
+            }
+        }
+
+        timerCallback();
+    }
+
+    void timerCallback() override
+    {
+        if (pipeline == nullptr)
+        {
+            tuneButton.setEnabled (false);
+            return;
+        }
+
+        const bool tuning = pipeline->isTuningBuffer();
+        tuneButton.setButtonText (tuning ? "Cancel tuning" : "Auto-tune buffer");
+
+        if (errorCountdown > 0 && ! tuning)
+        {
+            --errorCountdown;
+            tuneStatus.setText (errorText, juce::dontSendNotification);
+            return;
+        }
+
+        tuneStatus.setText (pipeline->getBufferTuningStatus(), juce::dontSendNotification);
+    }
+
+    juce::WeakReference<AudioPipeline> pipeline;
+    juce::AudioDeviceSelectorComponent selector;
+    juce::TextButton tuneButton { "Auto-tune buffer" };
+    juce::Label tuneStatus;
+    juce::String errorText;
+    int errorCountdown = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioSettingsPanel)
+};
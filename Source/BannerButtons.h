@@ -148,6 +148,7 @@ public:
     void onBypassToggled (std::function<void(bool)> cb) { bypassCallback = std::move (cb); }
 
     void setButtonSize (int newSize) { buttonSize = newSize; resized(); }
+    void setBypassState (bool isBypassed) { bypassButton.setToggleState (isBypassed, juce::dontSendNotification); }
 
 private:
     IconButton fullScreenButton { IconButton::IconType::Fullscreen };
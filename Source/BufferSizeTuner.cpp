@@ -0,0 +1,225 @@
+#include "BufferSizeTuner.h"
+
+//==============================================================================
+BufferSizeTuner::BufferSizeTuner (juce::AudioDeviceManager& dm, CallbackLoadMonitor& m,
+                                  const EngineSettings& s, const juce::String& key)
+    : deviceManager (dm), monitor (m), settings (s), resultKey (key)
+{
+    loadResult();
+}
+
+BufferSizeTuner::~BufferSizeTuner()
+{
+    stopTimer();
+}
+
+juce::String BufferSizeTuner::start()
+{
+    if (isRunning())
+        return {};
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+
+    if (device == nullptr)
+        return "No audio device is open.";
+
+    candidates.clear();
+
+    for (auto size : device->getAvailableBufferSizes())
+        if (size > 0 && size <= maxCandidateSize)
+            candidates.addIfNotAlreadyThere (size);
+
+    candidates.sort();
+
+    if (candidates.isEmpty())
+        return "The device doesn't report any buffer sizes to choose from.";
+
+    originalBufferSize = device->getCurrentBufferSizeSamples();
+    measuredLoads.clearQuick();
+    candidateIndex = 0;
+
+    if (settings.tuneSyntheticLoad && onSyntheticLoad != nullptr)
+        onSyntheticLoad (true);
+
+    juce::Logger::writeToLog ("Buffer tuner: trying " + juce::String (candidates.size()) + " sizes on "
+                              + device->getName() + ", target p99.9 under " + juce::String (settings.tuneTargetPercent)
+                              + "% of the period");
+
+    if (! applyBufferSize (candidates.getFirst()))
+    {
+        cancel();
+        return "The device refused buffer size " + juce::String (candidates.getFirst()) + ".";
+    }
+
+    startTimer (100);
+    return {};
+}
+
+void BufferSizeTuner::cancel()
+{
+    if (! isRunning() && candidates.isEmpty())
+        return;
+
+    stopTimer();
+    candidates.clear();
+
+    if (onSyntheticLoad != nullptr)
+        onSyntheticLoad (false);
+
+    if (originalBufferSize > 0)
+        applyBufferSize (originalBufferSize);
+}
+
+juce::String BufferSizeTuner::getStatus() const
+{
+    if (isRunning())
+        return "Tuning " + juce::String (candidates[candidateIndex]) + " smp ("
+               + juce::String (candidateIndex + 1) + "/" + juce::String (candidates.size()) + ")...";
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+
+    if (device == nullptr || result.bufferSize <= 0 || device->getCurrentBufferSizeSamples() != result.bufferSize)
+        return {};
+
+    const double rate = device->getCurrentSampleRate();
+    const int roundTrip = device->getInputLatencyInSamples() + device->getOutputLatencyInSamples();
+    auto toMs = [rate] (int samples) { return juce::String (1000.0 * samples / rate, 1) + " ms"; };
+
+    return "Buffer " + juce::String (result.bufferSize) + " smp = " + toMs (result.bufferSize)
+           + (roundTrip > 0 ? ", round trip " + toMs (roundTrip) : juce::String())
+           + " (tuned, p99.9 " + juce::String (juce::roundToInt (result.p999 * 100.0)) + "%"
+           + (result.metTarget ? ")" : ", over target)");
+}
+
+//==============================================================================
+void BufferSizeTuner::timerCallback()
+{
+    const auto elapsed = juce::Time::getMillisecondCounter() - phaseStartMs;
+
+    if (phase == Phase::settling)
+    {
+        if (elapsed < (juce::uint32) settleMs)
+            return;
+
+        // The restart itself and the first blocks after it are not representative.
+        monitor.reset();
+        xrunBaseline = getDeviceXRuns();
+        phase = Phase::measuring;
+        phaseStartMs = juce::Time::getMillisecondCounter();
+        return;
+    }
+
+    // Large buffers call back rarely; give them longer to collect enough callbacks, up
+    // to a point.
+    const auto measureMs = (juce::uint32) settings.tuneSecondsPerSize * 1000u;
+
+    if (elapsed >= measureMs && (monitor.getNumCallbacks() >= minCallbacks || elapsed >= 4 * measureMs))
+        evaluate();
+}
+
+bool BufferSizeTuner::applyBufferSize (int size)
+{
+    auto setup = deviceManager.getAudioDeviceSetup();
+    setup.bufferSize = size;
+
+    auto error = deviceManager.setAudioDeviceSetup (setup, true);
+
+    if (error.isNotEmpty())
+        juce::Logger::writeToLog ("Buffer tuner: " + juce::String (size) + " smp refused: " + error);
+
+    phase = Phase::settling;
+    phaseStartMs = juce::Time::getMillisecondCounter();
+    return error.isEmpty();
+}
+
+void BufferSizeTuner::evaluate()
+{
+    const double p999 = monitor.getPercentile (0.999);
+    const auto overruns = (int) monitor.getNumOverruns();
+    const int deviceXRuns = xrunBaseline >= 0 ? juce::jmax (0, getDeviceXRuns() - xrunBaseline) : 0;
+    const bool passed = p999 <= settings.tuneTargetPercent / 100.0 && overruns == 0 && deviceXRuns == 0;
+
+    juce::Logger::writeToLog ("Buffer tuner: " + juce::String (candidates[candidateIndex]) + " smp, p99.9 "
+                              + juce::String (juce::roundToInt (p999 * 100.0)) + "%, p50 "
+                              + juce::String (juce::roundToInt (monitor.getPercentile (0.5) * 100.0)) + "%, "
+                              + juce::String (overruns) + " overruns, " + juce::String (deviceXRuns) + " device xruns over "
+                              + juce::String (monitor.getNumCallbacks()) + " callbacks" + (passed ? " - OK" : ""));
+
+    measuredLoads.add (p999);
+
+    if (passed)
+    {
+        finish (candidateIndex, true);
+        return;
+    }
+
+    ++candidateIndex;
+
+    // Sizes the device won't take are dropped rather than measured.
+    while (candidateIndex < candidates.size() && ! applyBufferSize (candidates[candidateIndex]))
+        candidates.remove (candidateIndex);
+
+    // Nothing met the target: settle for the largest size, the safest we have.
+    if (candidateIndex >= candidates.size())
+        finish (candidates.size() - 1, false);
+}
+
+void BufferSizeTuner::finish (int chosenIndex, bool metTarget)
+{
+    stopTimer();
+
+    if (onSyntheticLoad != nullptr)
+        onSyntheticLoad (false);
+
+    const int chosen = candidates[chosenIndex];
+
+    if (auto* device = deviceManager.getCurrentAudioDevice(); device == nullptr || device->getCurrentBufferSizeSamples() != chosen)
+        applyBufferSize (chosen);
+
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+    {
+        result.bufferSize = chosen;
+        result.sampleRate = device->getCurrentSampleRate();
+        result.p999 = measuredLoads[chosenIndex];
+        result.metTarget = metTarget;
+        result.deviceName = device->getName();
+        storeResult();
+    }
+
+    juce::Logger::writeToLog ("Buffer tuner: chose " + juce::String (chosen) + " smp"
+                              + (metTarget ? juce::String() : " (no size met the target)"));
+
+    candidates.clear();
+    originalBufferSize = 0;
+}
+
+int BufferSizeTuner::getDeviceXRuns() const
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    return device != nullptr ? device->getXRunCount() : -1;
+}
+
+// The device setup itself (including the buffer size) is already saved with the
+// pipeline's device state; this keeps what the tuner measured alongside it.
+void BufferSizeTuner::loadResult()
+{
+    if (auto xml = EngineSettings::loadXml (resultKey))
+    {
+        result.bufferSize = xml->getIntAttribute ("bufferSize");
+        result.sampleRate = xml->getDoubleAttribute ("sampleRate");
+        result.p999 = xml->getDoubleAttribute ("p999");
+        result.metTarget = xml->getBoolAttribute ("metTarget");
+        result.deviceName = xml->getStringAttribute ("device");
+    }
+}
+
+void BufferSizeTuner::storeResult() const
+{
+    juce::XmlElement xml ("BUFFERTUNING");
+    xml.setAttribute ("bufferSize", result.bufferSize);
+    xml.setAttribute ("sampleRate", result.sampleRate);
+    xml.setAttribute ("p999", result.p999);
+    xml.setAttribute ("metTarget", result.metTarget);
+    xml.setAttribute ("device", result.deviceName);
+    EngineSettings::storeXml (resultKey, xml);
+}
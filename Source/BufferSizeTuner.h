@@ -0,0 +1,78 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CallbackLoadMonitor.h"
+#include "EngineSettings.h"
+#include <functional>
+
+// Finds the smallest device buffer size the loaded plugin can run at safely.
+//
+// The device is stepped through its available buffer sizes from the smallest up. At
+// each one the tuner lets the device settle, measures callback load and xruns for a
+// while, and stops at the first size whose p99.9 callback time stays under the target
+// fraction of the period with no xruns. It measures with live input, or with the input
+// replaced by noise and the output muted, so a silent room doesn't idle the plugin. The
+// outcome is stored with the pipeline's settings and the device keeps the chosen size.
+//
+// Runs entirely on the message thread.
+class BufferSizeTuner  : private juce::Timer
+{
+public:
+    struct Result
+    {
+        int bufferSize = 0;
+        double sampleRate = 0.0;
+        double p999 = 0.0;              // fraction of the period
+        bool metTarget = false;
+        juce::String deviceName;
+    };
+
+    BufferSizeTuner (juce::AudioDeviceManager& deviceManager, CallbackLoadMonitor& monitor,
+                     const EngineSettings& settings, const juce::String& resultKey);
+    ~BufferSizeTuner() override;
+
+    // Returns an error message if tuning can't start.
+    juce::String start();
+    void cancel();
+
+    bool isRunning() const noexcept     { return isTimerRunning(); }
+    const Result& getResult() const noexcept   { return result; }
+
+    // e.g. "Tuning 128 smp (2/6)..." or "Buffer 128 smp = 2.7 ms, round trip 7.9 ms (tuned, p99.9 41%)".
+    juce::String getStatus() const;
+
+    // Called with true while the tuner wants the synthetic load on.
+    std::function<void (bool)> onSyntheticLoad;
+
+private:
+    enum class Phase { settling, measuring };
+
+    void timerCallback() override;
+    bool applyBufferSize (int size);
+    void evaluate();
+    void finish (int chosenIndex, bool metTarget);
+    int getDeviceXRuns() const;
+    void loadResult();
+    void storeResult() const;
+
+    juce::AudioDeviceManager& deviceManager;
+    CallbackLoadMonitor& monitor;
+    const EngineSettings& settings;
+    const juce::String resultKey;
+
+    juce::Array<int> candidates;
+    juce::Array<double> measuredLoads;
+    int candidateIndex = 0;
+    Phase phase = Phase::settling;
+    juce::uint32 phaseStartMs = 0;
+    int xrunBaseline = -1;
+    int originalBufferSize = 0;
+
+    Result result;
+
+    static constexpr int settleMs = 750;
+    static constexpr int maxCandidateSize = 4096;
+    static constexpr juce::uint32 minCallbacks = 200;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BufferSizeTuner)
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+
+// Histogram of how long the device callback takes, as a fraction of the period it was
+// given. The audio thread records every callback; the message thread reads percentiles
+// at any time. Bins are 1% of the period wide, so p99.9 is resolved to a percent, which
+// is all a buffer-size decision needs.
+class CallbackLoadMonitor
+{
+public:
+    // Message thread, while the audio callback is stopped.
+    void prepare (double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        clear();
+        resetRequested.store (false);
+    }
+
+    // Message thread. The audio thread clears the counts at its next callback, so the
+    // next reading only covers what happens from now on.
+    void reset() noexcept                { resetRequested.store (true); }
+
+    // Audio thread.
+    juce::int64 begin() const noexcept   { return juce::Time::getHighResolutionTicks(); }
+
+    void end (juce::int64 startTicks, int numSamples) noexcept
+    {
+        if (resetRequested.exchange (false))
+            clear();
+
+        if (numSamples <= 0 || sampleRate <= 0.0)
+            return;
+
+        const double seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+        const double load = seconds * sampleRate / numSamples;
+        const int bin = juce::jlimit (0, numBins - 1, (int) std::ceil (load * 100.0));
+
+        increment (bins[(size_t) bin]);
+        increment (numCallbacks);
+
+        if (load > 1.0)
+            increment (numOverruns);
+    }
+
+    //==============================================================================
+    // Message thread.
+    juce::uint32 getNumCallbacks() const noexcept   { return numCallbacks.load(); }
+
+    // Callbacks that took longer than their own period.
+    juce::uint32 getNumOverruns() const noexcept    { return numOverruns.load(); }
+
+    // Load (1.0 = the whole period) that the given fraction of callbacks stayed within.
+    // Anything beyond the histogram counts as its last bin.
+    double getPercentile (double fraction) const noexcept
+    {
+        std::array<juce::uint32, (size_t) numBins> snapshot;
+        juce::uint64 total = 0;
+
+        for (size_t i = 0; i < snapshot.size(); ++i)
+            total += (snapshot[i] = bins[i].load (std::memory_order_relaxed));
+
+        if (total == 0)
+            return 0.0;
+
+        const auto wanted = (juce::uint64) std::ceil ((double) total * fraction);
+        juce::uint64 seen = 0;
+
+        for (size_t i = 0; i < snapshot.size(); ++i)
+            if ((seen += snapshot[i]) >= wanted)
+                return (double) i / 100.0;
+
+        return (double) (numBins - 1) / 100.0;
+    }
+
+private:
+    static void increment (std::atomic<juce::uint32>& counter) noexcept
+    {
+        // Single writer, so a plain load/store is enough and avoids a locked instruction.
+        counter.store (counter.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clear() noexcept
+    {
+        for (auto& bin : bins)
+            bin.store (0, std::memory_order_relaxed);
+
+        numCallbacks.store (0);
+        numOverruns.store (0);
+    }
+
+    static constexpr int numBins = 401;     // 0..400% of the period
+
+    double sampleRate = 0.0;
+    std::array<std::atomic<juce::uint32>, (size_t) numBins> bins {};
+    std::atomic<juce::uint32> numCallbacks { 0 };
+    std::atomic<juce::uint32> numOverruns { 0 };
+    std::atomic<bool> resetRequested { false };
+};
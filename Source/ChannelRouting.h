@@ -0,0 +1,264 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "EngineSettings.h"
+#include "MemoryResidency.h"
+
+// Maps device channels onto each plugin instance's buses.
+//
+// Every instance gets its stereo pair on the main bus. On top of that, configured device
+// inputs can feed every instance's sidechain, and each instance's extra outputs can go
+// to its own group of device outputs. The plugin sees an AudioBuffer whose main and
+// output channel pointers point straight into the device buffer. Sidechain keys are the
+// exception: they are shared by every pair, all rendering at once, and nothing stops a
+// plugin from writing to its input-only channels, so each instance gets its own copy of
+// the key. That copy goes into the channel's output destination when it has one (JUCE
+// shares one channel for input j and output j), and into the pair's scratch otherwise.
+//
+// The layout is negotiated through the bus API before the plugin is prepared. A separate
+// sidechain bus and separate output buses are tried first. Next comes a wider main bus,
+// which is how VST2 plugins take a key. After that the routing drops the extra outputs,
+// then the sidechain. Whatever the plugin ends up with, process() builds its view from
+// the channel counts it actually reports.
+class ChannelRouting
+{
+public:
+    static constexpr int maxPluginChannels = 32;
+
+    // Message thread, before anything is prepared.
+    void configure (const EngineSettings& settings)
+    {
+        numMainChannels = settings.numChannels;
+        sidechainInputs = settings.sidechainInputs;
+        sidechainInputs.removeRange (maxPluginChannels - 2, sidechainInputs.size());
+        auxOutputs = settings.auxOutputs;
+        numAuxPerPair = juce::jmin (maxPluginChannels - 2, auxOutputs.size() / juce::jmax (1, settings.getNumChannelPairs()));
+        numRenderChannels = juce::jmax (settings.getNumDeviceInputs(), settings.getNumDeviceOutputs());
+    }
+
+    int getNumSidechainChannels() const noexcept   { return sidechainInputs.size(); }
+    int getNumAuxChannels() const noexcept         { return numAuxPerPair; }
+
+    // Channels the render stages carry: the main pairs plus any sidechain and aux ones.
+    int getNumRenderChannels() const noexcept      { return numRenderChannels; }
+
+    //==============================================================================
+    // Message or loader thread, while the plugin is not prepared. Returns a description
+    // of the layout the plugin accepted.
+    juce::String applyLayout (juce::AudioPluginInstance& plugin) const
+    {
+        const int sidechain = getNumSidechainChannels();
+        const int aux = getNumAuxChannels();
+
+        const bool applied = tryLayout (plugin, sidechain, aux, true) || tryLayout (plugin, sidechain, aux, false)
+                          || tryLayout (plugin, sidechain, 0, true)   || tryLayout (plugin, sidechain, 0, false)
+                          || tryLayout (plugin, 0, aux, true)         || tryLayout (plugin, 0, aux, false)
+                          || tryLayout (plugin, 0, 0, true);
+
+        const int ins = plugin.getTotalNumInputChannels();
+        const int outs = plugin.getTotalNumOutputChannels();
+        juce::String description (juce::jmin (2, ins));
+        description << " in";
+
+        if (ins > 2)
+            description << " + " << (ins - 2) << " sidechain";
+
+        description << ", " << juce::jmin (2, outs) << " out";
+
+        if (outs > 2)
+            description << " + " << (outs - 2) << " aux";
+
+        return applied ? description : description + " (plugin default)";
+    }
+
+    // Message thread, while the audio callback is stopped.
+    void prepareScratch (juce::AudioBuffer<float>& scratch, int maxBlockSize) const
+    {
+        scratch.setSize (maxPluginChannels, juce::jmax (1, maxBlockSize), false, true, false);
+        MemoryResidency::prefault (scratch);
+    }
+
+    //==============================================================================
+    // Render thread. Calls render (view) with the plugin's view of one pair. main holds
+    // that pair's two channels, device the whole render buffer they came from. Each
+    // extra output is passed to onAuxOutput after rendering, for guarding.
+    template <typename RenderFn, typename AuxFn>
+    void process (juce::AudioBuffer<float>& main, juce::AudioBuffer<float>& device, int pairIndex,
+                  const juce::AudioPluginInstance& plugin, juce::AudioBuffer<float>& scratch,
+                  RenderFn&& render, AuxFn&& onAuxOutput) const noexcept
+    {
+        const int numIns = plugin.getTotalNumInputChannels();
+        const int numOuts = plugin.getTotalNumOutputChannels();
+        const int width = juce::jlimit (2, maxPluginChannels, juce::jmax (numIns, numOuts));
+        const int numSamples = main.getNumSamples();
+
+        if (width <= 2 && numAuxPerPair == 0)
+        {
+            render (main);
+            return;
+        }
+
+        if (numSamples > scratch.getNumSamples())
+        {
+            // More than we prepared for; run the main pair only.
+            render (main);
+            return;
+        }
+
+        float* channels[maxPluginChannels];
+        channels[0] = main.getWritePointer (0);
+        channels[1] = main.getWritePointer (1);
+
+        for (int ch = 2; ch < width; ++ch)
+        {
+            const bool isInput = ch < numIns;
+            const bool isOutput = ch < numOuts;
+            const auto* key = isInput ? getDeviceChannel (device, getSidechainInput (ch - 2)) : nullptr;
+            auto* destination = isOutput ? getDeviceChannel (device, getAuxOutput (pairIndex, ch - 2)) : nullptr;
+
+            if (destination == nullptr)
+                destination = scratch.getWritePointer (ch);
+
+            if (key != nullptr)
+                juce::FloatVectorOperations::copy (destination, key, numSamples);
+            else if (isInput)
+                juce::FloatVectorOperations::clear (destination, numSamples);
+
+            channels[ch] = destination;
+        }
+
+        juce::AudioBuffer<float> view (channels, width, numSamples);
+        render (view);
+
+        // Aux outputs the plugin doesn't have stay silent.
+        for (int aux = 0; aux < numAuxPerPair; ++aux)
+        {
+            if (auto* destination = getDeviceChannel (device, getAuxOutput (pairIndex, aux)))
+            {
+                if (aux + 2 >= numOuts)
+                {
+                    juce::FloatVectorOperations::clear (destination, numSamples);
+                }
+                else
+                {
+                    juce::AudioBuffer<float> auxView (&destination, 1, numSamples);
+                    onAuxOutput (auxView);
+                }
+            }
+        }
+    }
+
+    // Render thread, after process(). Scales one pair's aux outputs by a gain ramp, so
+    // they follow the bypass crossfade; at 0 they are cleared, which also covers a
+    // plugin that was never called and left the device input in them.
+    void applyAuxGain (juce::AudioBuffer<float>& device, int pairIndex, float startGain, float endGain) const noexcept
+    {
+        if (startGain == 1.0f && endGain == 1.0f)
+            return;
+
+        const int numSamples = device.getNumSamples();
+
+        for (int aux = 0; aux < numAuxPerPair; ++aux)
+        {
+            if (auto* destination = getDeviceChannel (device, getAuxOutput (pairIndex, aux)))
+            {
+                if (startGain == 0.0f && endGain == 0.0f)
+                {
+                    juce::FloatVectorOperations::clear (destination, numSamples);
+                }
+                else
+                {
+                    juce::AudioBuffer<float> auxView (&destination, 1, numSamples);
+                    auxView.applyGainRamp (0, 0, numSamples, startGain, endGain);
+                }
+            }
+        }
+    }
+
+    // Render thread, after every pair has rendered. Extra device channels that no
+    // plugin writes to would otherwise play back whatever the device delivered on the
+    // input side.
+    void clearUnroutedOutputs (juce::AudioBuffer<float>& device) const noexcept
+    {
+        for (int ch = numMainChannels; ch < device.getNumChannels(); ++ch)
+            if (! auxOutputs.contains (ch))
+                device.clear (ch, 0, device.getNumSamples());
+    }
+
+private:
+    bool tryLayout (juce::AudioPluginInstance& plugin, int sidechain, int aux, bool separateBuses) const
+    {
+        auto layout = plugin.getBusesLayout();
+
+        if (layout.inputBuses.isEmpty() || layout.outputBuses.isEmpty())
+            return false;
+
+        auto widen = [] (int extra)
+        {
+            return extra > 0 ? juce::AudioChannelSet::discreteChannels (2 + extra) : juce::AudioChannelSet::stereo();
+        };
+
+        for (auto& bus : layout.inputBuses)   bus = juce::AudioChannelSet::disabled();
+        for (auto& bus : layout.outputBuses)  bus = juce::AudioChannelSet::disabled();
+
+        if (separateBuses)
+        {
+            layout.inputBuses.getReference (0) = juce::AudioChannelSet::stereo();
+            layout.outputBuses.getReference (0) = juce::AudioChannelSet::stereo();
+
+            if (sidechain > 0)
+            {
+                if (layout.inputBuses.size() < 2)
+                    return false;
+
+                layout.inputBuses.getReference (1) = juce::AudioChannelSet::canonicalChannelSet (sidechain);
+            }
+
+            // Extra outputs go out in stereo buses, the last one possibly mono.
+            int remaining = aux;
+
+            for (int bus = 1; bus < layout.outputBuses.size() && remaining > 0; ++bus)
+            {
+                const int busChannels = juce::jmin (2, remaining);
+                layout.outputBuses.getReference (bus) = juce::AudioChannelSet::canonicalChannelSet (busChannels);
+                remaining -= busChannels;
+            }
+
+            if (remaining > 0)
+                return false;
+        }
+        else
+        {
+            // Nothing extra to ask for, so this would be the same as the separate-bus attempt.
+            if (sidechain == 0 && aux == 0)
+                return false;
+
+            layout.inputBuses.getReference (0) = widen (sidechain);
+            layout.outputBuses.getReference (0) = widen (aux);
+        }
+
+        return plugin.checkBusesLayoutSupported (layout) && plugin.setBusesLayout (layout);
+    }
+
+    int getSidechainInput (int index) const noexcept
+    {
+        return juce::isPositiveAndBelow (index, sidechainInputs.size()) ? sidechainInputs.getUnchecked (index) : -1;
+    }
+
+    int getAuxOutput (int pairIndex, int index) const noexcept
+    {
+        const int slot = pairIndex * numAuxPerPair + index;
+        return index < numAuxPerPair && juce::isPositiveAndBelow (slot, auxOutputs.size()) ? auxOutputs.getUnchecked (slot) : -1;
+    }
+
+    static float* getDeviceChannel (juce::AudioBuffer<float>& device, int channel) noexcept
+    {
+        return juce::isPositiveAndBelow (channel, device.getNumChannels()) ? device.getWritePointer (channel) : nullptr;
+    }
+
+    int numMainChannels = 2;
+    int numAuxPerPair = 0;
+    int numRenderChannels = 2;
+    juce::Array<int> sidechainInputs;
+    juce::Array<int> auxOutputs;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// Takes the plugin out of the signal path when it can't keep up.
+//
+// The render side reports how long the plugin took for each block. Once that exceeds
+// the threshold share of the block's duration for a run of consecutive blocks, the
+// watchdog trips: the pipeline crossfades to its latency-compensated dry path and stops
+// calling the plugin. After a back-off it lets the plugin back in. Tripping again soon
+// after a retry doubles the back-off, up to a minute; a clean stretch resets it. A
+// plugin stuck over budget then costs a few blocks of crackle now and then instead of
+// minutes of it.
+class CpuWatchdog
+{
+public:
+    // What the plugin was doing when the watchdog last tripped.
+    struct Trip
+    {
+        float averageLoad = 0.0f;   // fractions of the block duration
+        float peakLoad = 0.0f;
+        int numBlocks = 0;
+        float blockMs = 0.0f;
+        int backoffMs = 0;
+    };
+
+    // Message thread, while the audio callback is stopped. thresholdPercent 0 turns
+    // the watchdog off.
+    void prepare (double sampleRate, int thresholdPercent, int numBlocks, int retryMs)
+    {
+        rate = sampleRate;
+        ticksPerSample = (double) juce::Time::getHighResolutionTicksPerSecond() / sampleRate;
+        threshold = thresholdPercent / 100.0;
+        blocksToTrip = juce::jmax (1, numBlocks);
+        initialBackoff = (juce::int64) (sampleRate * retryMs / 1000.0);
+        backoff = initialBackoff;
+
+        // A restart clears any protection in force; the plugin gets a fresh chance.
+        protecting = false;
+        protectingFlag.store (false);
+        overRun = 0;
+        overSum = 0.0;
+        overPeak = 0.0;
+        position = 0;
+        retryAt = 0;
+        probationEnd = 0;
+    }
+
+    // Render thread.
+    bool isProtecting() const noexcept      { return protecting; }
+
+    // Render thread, once per block. pluginTicks is the high-resolution time the plugin
+    // calls took, numSamples the block's length.
+    void endBlock (juce::int64 pluginTicks, int numSamples) noexcept
+    {
+        if (threshold <= 0.0 || numSamples <= 0)
+            return;
+
+        position += numSamples;
+
+        if (protecting)
+        {
+            if (position >= retryAt)
+            {
+                protecting = false;
+                protectingFlag.store (false);
+                retries.fetch_add (1);
+                probationEnd = position + (juce::int64) (rate * probationSeconds);
+            }
+
+            return;
+        }
+
+        const double load = (double) pluginTicks / (numSamples * ticksPerSample);
+
+        if (load <= threshold)
+        {
+            overRun = 0;
+            overSum = 0.0;
+            overPeak = 0.0;
+            return;
+        }
+
+        ++overRun;
+        overSum += load;
+        overPeak = juce::jmax (overPeak, load);
+
+        if (overRun < blocksToTrip)
+            return;
+
+        // Straight back in trouble after a retry: wait longer next time.
+        backoff = position < probationEnd ? juce::jmin (backoff * 2, (juce::int64) (rate * maxBackoffSeconds))
+                                          : initialBackoff;
+        retryAt = position + backoff;
+
+        lastAverageLoad.store ((float) (overSum / overRun));
+        lastPeakLoad.store ((float) overPeak);
+        lastNumBlocks.store (overRun);
+        lastBlockMs.store ((float) (1000.0 * numSamples / rate));
+        lastBackoffMs.store ((int) (1000.0 * (double) backoff / rate));
+        trips.fetch_add (1);
+
+        protecting = true;
+        protectingFlag.store (true);
+        overRun = 0;
+        overSum = 0.0;
+        overPeak = 0.0;
+    }
+
+    // Any thread.
+    bool isProtectingNow() const noexcept   { return protectingFlag.load(); }
+    int getTripCount() const noexcept       { return trips.load(); }
+    int getRetryCount() const noexcept      { return retries.load(); }
+
+    Trip getLastTrip() const noexcept
+    {
+        return { lastAverageLoad.load(), lastPeakLoad.load(), lastNumBlocks.load(), lastBlockMs.load(), lastBackoffMs.load() };
+    }
+
+private:
+    static constexpr double probationSeconds = 30.0;
+    static constexpr double maxBackoffSeconds = 60.0;
+
+    double rate = 44100.0;
+    double ticksPerSample = 1.0;
+    double threshold = 0.0;
+    int blocksToTrip = 8;
+    juce::int64 initialBackoff = 0;
+
+    // Render thread only.
+    bool protecting = false;
+    int overRun = 0;
+    double overSum = 0.0;
+    double overPeak = 0.0;
+    juce::int64 position = 0;
+    juce::int64 backoff = 0;
+    juce::int64 retryAt = 0;
+    juce::int64 probationEnd = 0;
+
+    std::atomic<bool> protectingFlag { false };
+    std::atomic<int> trips { 0 };
+    std::atomic<int> retries { 0 };
+    std::atomic<float> lastAverageLoad { 0.0f };
+    std::atomic<float> lastPeakLoad { 0.0f };
+    std::atomic<int> lastNumBlocks { 0 };
+    std::atomic<float> lastBlockMs { 0.0f };
+    std::atomic<int> lastBackoffMs { 0 };
+};
@@ -0,0 +1,250 @@
+#include "DiskRecorder.h"
+
+//==============================================================================
+DiskRecorder::~DiskRecorder()
+{
+    recording.store (false);
+    stopThread (4000);
+
+    const juce::ScopedLock sl (writerLock);
+    drain (true);
+    closeFiles();
+}
+
+bool DiskRecorder::prepare (int numChannels, double sampleRate, int maxBlockSize, int bufferSeconds)
+{
+    const juce::ScopedLock sl (writerLock);
+    numChannels = juce::jlimit (1, maxChannels, numChannels);
+
+    inputCapture.setSize (numChannels, juce::jmax (1, maxBlockSize), false, true, false);
+    silence.setSize (1, juce::jmax (1, maxBlockSize), false, true, false);
+    silence.clear();
+
+    if (numChannels == channels && sampleRate == rate && fifo.getNumChannels() > 0)
+        return false;
+
+    const bool wasRecording = recording.exchange (false);
+    drain (true);
+    closeFiles();
+
+    channels = numChannels;
+    rate = sampleRate;
+
+    const int capacity = (int) (sampleRate * juce::jmax (1, bufferSeconds));
+    fifo.setSize (2 * channels, capacity);
+    chunk.setSize (2 * channels, chunkSamples, false, true, false);
+    writeThreshold = juce::jmin (chunkSamples, capacity / 4);
+
+    return wasRecording;
+}
+
+juce::String DiskRecorder::start (const juce::File& folder, const juce::String& baseName,
+                                  const juce::String& format, bool includeInput)
+{
+    const juce::ScopedLock sl (writerLock);
+
+    if (recording.load())
+        return {};
+
+    if (fifo.getNumChannels() == 0)
+        return "The audio device hasn't started yet.";
+
+    // Whatever is left of the last recording goes out first.
+    drain (true);
+    closeFiles();
+
+    if (! folder.createDirectory())
+        return "Couldn't create " + folder.getFullPathName();
+
+    const auto extension = format == "flac" ? juce::String (".flac") : juce::String (".wav");
+    juce::String error;
+
+    outputFile = folder.getNonexistentChildFile (baseName + " output", extension, false);
+    outputWriter = createWriter (outputFile, format, error);
+
+    if (outputWriter != nullptr && includeInput)
+        inputWriter = createWriter (folder.getNonexistentChildFile (baseName + " input", extension, false), format, error);
+
+    if (outputWriter == nullptr || (includeInput && inputWriter == nullptr))
+    {
+        closeFiles();
+        return error;
+    }
+
+    samplesWritten.store (0);
+    lastFlush = juce::Time::getMillisecondCounter();
+    withInput.store (includeInput);
+    recording.store (true);
+    return {};
+}
+
+void DiskRecorder::stop()
+{
+    recording.store (false);
+    notify();
+}
+
+std::unique_ptr<juce::AudioFormatWriter> DiskRecorder::createWriter (const juce::File& file, const juce::String& format,
+                                                                     juce::String& error) const
+{
+    auto fileStream = std::make_unique<juce::FileOutputStream> (file, streamBufferBytes);
+
+    if (fileStream->failedToOpen())
+    {
+        error = "Couldn't open " + file.getFullPathName() + ": " + fileStream->getStatus().getErrorMessage();
+        return {};
+    }
+
+    std::unique_ptr<juce::AudioFormat> audioFormat;
+
+    if (format == "flac")
+        audioFormat = std::make_unique<juce::FlacAudioFormat>();
+    else
+        audioFormat = std::make_unique<juce::WavAudioFormat>();
+
+    std::unique_ptr<juce::OutputStream> stream (std::move (fileStream));
+    auto writer = audioFormat->createWriterFor (stream, juce::AudioFormatWriterOptions{}.withSampleRate (rate)
+                                                                                        .withNumChannels (channels)
+                                                                                        .withBitsPerSample (bitsPerSample));
+
+    if (writer == nullptr)
+        error = "Couldn't write " + audioFormat->getFormatName() + " at " + juce::String (rate) + " Hz, "
+                + juce::String (channels) + " channels";
+
+    return writer;
+}
+
+//==============================================================================
+void DiskRecorder::captureInput (const juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    inputCaptured = false;
+
+    if (! recording.load() || ! withInput.load() || numSamples > inputCapture.getNumSamples())
+        return;
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        if (ch < buffer.getNumChannels())
+            inputCapture.copyFrom (ch, 0, buffer, ch, 0, numSamples);
+        else
+            inputCapture.clear (ch, 0, numSamples);
+    }
+
+    inputCaptured = true;
+}
+
+void DiskRecorder::push (const juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    const bool captured = inputCaptured;
+    inputCaptured = false;
+
+    if (! recording.load() || numSamples <= 0)
+        return;
+
+    if (numSamples > silence.getNumSamples())
+    {
+        dropped.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Channels the device didn't open, or an input that wasn't captured this block,
+    // go down as silence so the files keep their timing.
+    float* pointers[2 * maxChannels];
+    auto* quiet = silence.getWritePointer (0);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        pointers[ch] = ch < buffer.getNumChannels() ? const_cast<float*> (buffer.getReadPointer (ch)) : quiet;
+        pointers[channels + ch] = captured ? inputCapture.getWritePointer (ch) : quiet;
+    }
+
+    const juce::AudioBuffer<float> view (pointers, withInput.load() ? 2 * channels : channels, numSamples);
+
+    if (fifo.getFreeSpace() < numSamples)
+    {
+        dropped.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
+
+    fifo.push (view, 0, numSamples);
+}
+
+//==============================================================================
+void DiskRecorder::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (writeIntervalMs);
+
+        const juce::ScopedLock sl (writerLock);
+
+        if (outputWriter == nullptr)
+            continue;
+
+        // Stopped: write out the rest and close.
+        const bool finishing = ! recording.load();
+        drain (finishing);
+
+        if (finishing)
+        {
+            closeFiles();
+        }
+        else if (juce::Time::getMillisecondCounter() - lastFlush >= flushIntervalMs)
+        {
+            lastFlush = juce::Time::getMillisecondCounter();
+            outputWriter->flush();
+
+            if (inputWriter != nullptr)
+                inputWriter->flush();
+        }
+    }
+}
+
+// Under writerLock. Writes whole chunks, or everything with everything set.
+void DiskRecorder::drain (bool everything)
+{
+    if (outputWriter == nullptr)
+    {
+        fifo.discard (fifo.getNumReady());
+        return;
+    }
+
+    for (;;)
+    {
+        const int ready = fifo.getNumReady();
+
+        if (ready == 0 || (! everything && ready < writeThreshold))
+            break;
+
+        const int numSamples = fifo.pull (chunk, 0, juce::jmin (ready, chunkSamples));
+        outputWriter->writeFromAudioSampleBuffer (chunk, 0, numSamples);
+
+        if (inputWriter != nullptr)
+        {
+            const juce::AudioBuffer<float> inputs (chunk.getArrayOfWritePointers() + channels, channels, numSamples);
+            inputWriter->writeFromAudioSampleBuffer (inputs, 0, numSamples);
+        }
+
+        samplesWritten.fetch_add (numSamples);
+    }
+}
+
+// Under writerLock. Deleting a writer finishes its header and closes the file.
+void DiskRecorder::closeFiles()
+{
+    outputWriter.reset();
+    inputWriter.reset();
+}
+
+juce::String DiskRecorder::getStatus() const
+{
+    if (! recording.load() || rate <= 0.0)
+        return {};
+
+    const auto seconds = (int) ((double) samplesWritten.load() / rate);
+    const auto buffered = (double) fifo.getNumReady() / rate;
+
+    return "REC " + juce::String (seconds / 3600) + ":" + juce::String ((seconds / 60) % 60).paddedLeft ('0', 2)
+           + ":" + juce::String (seconds % 60).paddedLeft ('0', 2) + " " + outputFile.getFileName()
+           + (withInput.load() ? " + input" : "") + ", " + juce::String (buffered, 1) + " s buffered";
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioFifo.h"
+#include <atomic>
+#include <memory>
+
+// Records what a pipeline sends to its device, and optionally what came in, to WAV or
+// FLAC files.
+//
+// The device callback only copies each block into a FIFO allocated up front; it never
+// waits on the disk, the encoder or a lock. A background thread wakes a few times a
+// second, takes whatever has built up in large chunks, encodes it and writes it through
+// a stream with a big buffer, so the disk sees long sequential writes. If the disk
+// falls further behind than the FIFO holds, blocks are dropped and counted rather than
+// stalling the audio. The files are flushed every few seconds, so a crash costs only the
+// last moments of an hours-long capture.
+class DiskRecorder  : private juce::Thread
+{
+public:
+    DiskRecorder() : juce::Thread ("Disk recorder")
+    {
+        startThread();
+    }
+
+    ~DiskRecorder() override;
+
+    // Message thread, while the audio callback is stopped. A recording carries on across
+    // a device restart at the same rate; otherwise it is finished first and this
+    // returns true.
+    bool prepare (int numChannels, double sampleRate, int maxBlockSize, int bufferSeconds);
+
+    // Message thread. Starts "<baseName> output.<format>", plus "<baseName> input.<format>"
+    // if includeInput is set, in folder. format is "wav" or "flac". Returns an error
+    // message on failure.
+    juce::String start (const juce::File& folder, const juce::String& baseName, const juce::String& format, bool includeInput);
+
+    // Message thread. The writer finishes off what is still buffered and closes the files.
+    void stop();
+    bool isRecording() const noexcept               { return recording.load(); }
+
+    // Device callback: the input before anything has touched the buffer, then the block
+    // as it goes to the device.
+    void captureInput (const juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+    void push (const juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    // Message thread. e.g. "REC 1:02:03 Zone 1 output.wav, 0.2 s buffered".
+    juce::String getStatus() const;
+
+    // Any thread. Blocks the FIFO had no room for.
+    int getDroppedCount() const noexcept            { return dropped.load(); }
+
+private:
+    void run() override;
+    void drain (bool everything);
+    void closeFiles();
+    std::unique_ptr<juce::AudioFormatWriter> createWriter (const juce::File& file, const juce::String& format, juce::String& error) const;
+
+    static constexpr int maxChannels = 64;
+    static constexpr int chunkSamples = 1 << 16;        // most samples per write call
+    static constexpr int streamBufferBytes = 1 << 20;   // so the disk sees large sequential writes
+    static constexpr int bitsPerSample = 24;
+    static constexpr int writeIntervalMs = 100;
+    static constexpr juce::uint32 flushIntervalMs = 5000;
+
+    AudioFifo fifo;                         // output channels, then input channels
+    juce::AudioBuffer<float> inputCapture;  // device callback only
+    juce::AudioBuffer<float> silence;       // for channels the device didn't open
+    bool inputCaptured = false;             // device callback only
+    int channels = 0;
+    double rate = 0.0;
+    int writeThreshold = chunkSamples;
+
+    // The writer thread and the message thread; the device callback never takes it.
+    juce::CriticalSection writerLock;
+    juce::AudioBuffer<float> chunk;
+    std::unique_ptr<juce::AudioFormatWriter> outputWriter, inputWriter;
+    juce::File outputFile;
+    juce::uint32 lastFlush = 0;
+
+    std::atomic<bool> recording { false };
+    std::atomic<bool> withInput { false };  // only changes while not recording
+    std::atomic<juce::int64> samplesWritten { 0 };
+    std::atomic<int> dropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiskRecorder)
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Host engine tuning, read once at startup from the user's starnails.settings file so
+// each rig can be configured without a rebuild. Missing keys are written back with their
+// defaults, which keeps the file self-documenting for operators.
+struct EngineSettings
+{
+    int crossfadeBlocks = 8;    // plugin hot-swap crossfade length, in device blocks
+    int lookaheadBlocks = 0;    // render this many blocks ahead on a DSP worker, 0 = in the callback
+    int fixedBlockSize = 0;     // re-block to this plugin block size, 0 = use the device period
+    int minSubBlockSize = 32;   // shortest plugin call when splitting blocks at parameter changes
+    int numPipelines = 1;       // independent device + plugin pipelines hosted by this process
+    juce::Array<int> pipelineCores; // CPU core for each pipeline's audio callback, -1 = leave it to the OS
+    int bypassFadeMs = 10;      // equal-power crossfade when bypass is toggled
+    int silenceThresholdDb = -90;   // input/output level below which the plugin counts as silent
+    int silenceHoldMs = 5000;   // idle the plugin after this much silence (plus its tail), 0 = never
+    juce::String rtPolicy { "none" };   // "fifo" or "rr" to put audio threads under SCHED_FIFO/SCHED_RR (Linux)
+    int rtAudioPriority = 80;   // scheduler priority for device callbacks
+    int rtWorkerPriority = 75;  // scheduler priority for DSP workers
+    juce::Array<int> audioCores;    // cores reserved for audio threads, empty = no isolation
+    juce::Array<int> uiCores;       // cores for the message thread and everything else, empty = all but the audio cores
+    int numChannels = 2;        // device channels per pipeline, processed as stereo pairs by one instance each
+    int workerThreads = -1;     // real-time workers running pairs in parallel, -1 = one per extra pair, up to one fewer than the (audio) cores
+    bool lockMemory = false;    // lock the process in RAM and prefault the audio path
+    juce::Array<int> sidechainInputs;   // extra device inputs feeding every instance's sidechain, e.g. "4,5"
+    juce::Array<int> auxOutputs;        // device outputs for the instances' extra outputs, split evenly between pairs
+    int tuneTargetPercent = 70; // buffer tuner: p99.9 callback time must stay under this share of the period
+    int tuneSecondsPerSize = 3; // buffer tuner: measuring time per buffer size
+    bool tuneSyntheticLoad = true;  // buffer tuner: drive the plugin with noise (output muted) instead of live input
+    juce::StringArray inputDevices; // separate capture device for each pipeline, resampled to the output clock, empty = the device's own inputs
+    int inputLatencyMs = 5;     // capture kept buffered for a separate input device to drift against
+    int watchdogPercent = 95;   // CPU watchdog: plugin time per block, as a share of the block, that counts as overload, 0 = off
+    int watchdogBlocks = 8;     // CPU watchdog: consecutive overloaded blocks before the plugin is bypassed
+    int watchdogRetryMs = 2000; // CPU watchdog: first wait before letting the plugin back in, doubled on repeat trips
+    bool builtInFallback = false; // load the built-in processing chain when no plugin file is found at startup
+    juce::StringArray midiInputs;   // MIDI input device for each pipeline, for hardware controllers, empty = none
+    juce::String chain;         // plugins hosted together at startup instead of Stardust alone, e.g. "PreEQ.dll > Stardust.dll > Limiter.dll", "|" for parallel branches
+    int chainWorkers = -1;      // pipeline workers a chain's parallel branches may borrow, -1 = one per extra branch, 0 = one branch after another
+    juce::String recordFolder;  // where recordings go, empty = "starnails" in the user's music folder
+    juce::String recordFormat { "wav" };    // "wav" or "flac", 24-bit either way
+    bool recordInput = false;   // also record the raw input, to a second file next to the output
+    int recordBufferSeconds = 10;   // audio held in memory for the disk writer to fall behind by
+
+    static juce::PropertiesFile::Options getFileOptions()
+    {
+        juce::PropertiesFile::Options options;
+        options.applicationName = "starnails";
+        options.filenameSuffix = ".settings";
+        options.folderName = "starnails";
+        options.osxLibrarySubFolder = "Application Support";
+        options.storageFormat = juce::PropertiesFile::storeAsXML;
+        return options;
+    }
+
+    static EngineSettings load()
+    {
+        juce::PropertiesFile props (getFileOptions());
+        EngineSettings s;
+
+        s.crossfadeBlocks = juce::jlimit (0, 256, readInt (props, "crossfadeBlocks", s.crossfadeBlocks));
+        s.lookaheadBlocks = juce::jlimit (0, 8, readInt (props, "lookaheadBlocks", s.lookaheadBlocks));
+        s.fixedBlockSize = juce::jlimit (0, 8192, readInt (props, "fixedBlockSize", s.fixedBlockSize));
+        s.minSubBlockSize = juce::jlimit (1, 8192, readInt (props, "minSubBlockSize", s.minSubBlockSize));
+        s.numPipelines = juce::jlimit (1, 16, readInt (props, "numPipelines", s.numPipelines));
+
+        s.bypassFadeMs = juce::jlimit (1, 500, readInt (props, "bypassFadeMs", s.bypassFadeMs));
+        s.silenceThresholdDb = juce::jlimit (-140, 0, readInt (props, "silenceThresholdDb", s.silenceThresholdDb));
+        s.silenceHoldMs = juce::jlimit (0, 600000, readInt (props, "silenceHoldMs", s.silenceHoldMs));
+        s.numChannels = 2 * juce::jlimit (1, 32, (readInt (props, "numChannels", s.numChannels) + 1) / 2);
+        s.workerThreads = juce::jlimit (-1, 31, readInt (props, "workerThreads", s.workerThreads));
+        s.lockMemory = readInt (props, "lockMemory", s.lockMemory ? 1 : 0) != 0;
+        s.tuneTargetPercent = juce::jlimit (10, 100, readInt (props, "tuneTargetPercent", s.tuneTargetPercent));
+        s.tuneSecondsPerSize = juce::jlimit (1, 60, readInt (props, "tuneSecondsPerSize", s.tuneSecondsPerSize));
+        s.tuneSyntheticLoad = readInt (props, "tuneSyntheticLoad", s.tuneSyntheticLoad ? 1 : 0) != 0;
+        s.inputLatencyMs = juce::jlimit (1, 200, readInt (props, "inputLatencyMs", s.inputLatencyMs));
+        s.watchdogPercent = juce::jlimit (0, 1000, readInt (props, "watchdogPercent", s.watchdogPercent));
+        s.watchdogBlocks = juce::jlimit (1, 1000, readInt (props, "watchdogBlocks", s.watchdogBlocks));
+        s.watchdogRetryMs = juce::jlimit (100, 60000, readInt (props, "watchdogRetryMs", s.watchdogRetryMs));
+        s.builtInFallback = readInt (props, "builtInFallback", s.builtInFallback ? 1 : 0) != 0;
+        s.chainWorkers = juce::jlimit (-1, 15, readInt (props, "chainWorkers", s.chainWorkers));
+        s.chain = readString (props, "chain", {}).trim();
+        s.recordFolder = readString (props, "recordFolder", {}).trim();
+        s.recordFormat = readString (props, "recordFormat", s.recordFormat).trim().toLowerCase() == "flac" ? "flac" : "wav";
+        s.recordInput = readInt (props, "recordInput", s.recordInput ? 1 : 0) != 0;
+        s.recordBufferSeconds = juce::jlimit (1, 120, readInt (props, "recordBufferSeconds", s.recordBufferSeconds));
+
+        s.pipelineCores = parseIntList (readString (props, "pipelineCores", {}));
+        s.rtPolicy = readString (props, "rtPolicy", s.rtPolicy).trim().toLowerCase();
+        s.rtAudioPriority = juce::jlimit (1, 99, readInt (props, "rtAudioPriority", s.rtAudioPriority));
+        s.rtWorkerPriority = juce::jlimit (1, 99, readInt (props, "rtWorkerPriority", s.rtWorkerPriority));
+        s.audioCores = parseIntList (readString (props, "audioCores", {}));
+        s.uiCores = parseIntList (readString (props, "uiCores", {}));
+
+        // Device names can contain commas (ALSA's "hw:CARD=x,DEV=0"), hence the semicolons.
+        s.inputDevices = juce::StringArray::fromTokens (readString (props, "inputDevices", {}), ";", {});
+        s.inputDevices.trim();
+        s.midiInputs = juce::StringArray::fromTokens (readString (props, "midiInputs", {}), ";", {});
+        s.midiInputs.trim();
+
+        // Both must lie past the main channels: those already belong to the pairs.
+        s.sidechainInputs = parseChannelList (readString (props, "sidechainInputs", {}), s.numChannels);
+        s.auxOutputs = parseChannelList (readString (props, "auxOutputs", {}), s.numChannels);
+
+        // One pair would write its aux output into a channel another is reading its key
+        // from, on another thread. The key wins.
+        for (auto channel : s.sidechainInputs)
+        {
+            if (s.auxOutputs.contains (channel))
+            {
+                s.auxOutputs.removeFirstMatchingValue (channel);
+                juce::Logger::writeToLog ("Settings: channel " + juce::String (channel)
+                                          + " is both a sidechain input and an aux output; dropped it from auxOutputs");
+            }
+        }
+
+        props.saveIfNeeded();
+        return s;
+    }
+
+    int getPipelineCore (int pipelineIndex) const noexcept
+    {
+        return juce::isPositiveAndBelow (pipelineIndex, pipelineCores.size()) ? juce::jmax (-1, pipelineCores.getUnchecked (pipelineIndex))
+                                                                              : -1;
+    }
+
+    int getNumChannelPairs() const noexcept    { return numChannels / 2; }
+
+    juce::String getInputDevice (int pipelineIndex) const
+    {
+        return inputDevices[pipelineIndex];
+    }
+
+    juce::String getMidiInput (int pipelineIndex) const
+    {
+        return midiInputs[pipelineIndex];
+    }
+
+    juce::File getRecordFolder() const
+    {
+        return recordFolder.isNotEmpty() ? juce::File (recordFolder)
+                                         : juce::File::getSpecialLocation (juce::File::userMusicDirectory).getChildFile ("starnails");
+    }
+
+    int getNumDeviceInputs() const noexcept
+    {
+        return juce::jmax (numChannels, sidechainInputs.isEmpty() ? 0 : getHighest (sidechainInputs) + 1);
+    }
+
+    int getNumDeviceOutputs() const noexcept
+    {
+        return juce::jmax (numChannels, auxOutputs.isEmpty() ? 0 : getHighest (auxOutputs) + 1);
+    }
+
+    int getNumWorkerThreads() const noexcept
+    {
+        const int wanted = workerThreads >= 0 ? workerThreads : getNumChannelPairs() - 1;
+        return juce::jlimit (0, getMaxWorkerThreads(), juce::jmin (wanted, getNumChannelPairs() - 1));
+    }
+
+    // Real-time workers one pipeline can have without any of them sharing a core with its
+    // callback. Under isolation that is one fewer than the audio cores: a worker pinned to
+    // the callback's core at a lower priority would never run while the callback waits.
+    int getMaxWorkerThreads() const noexcept
+    {
+        return juce::jmax (0, (audioCores.isEmpty() ? juce::SystemStats::getNumCpus() : audioCores.size()) - 1);
+    }
+
+    // The audio cores a pipeline's workers are pinned to, one each: all but the one its
+    // callback is pinned to, or all but the last when the callback has no core of its own.
+    juce::Array<int> getWorkerCores (int pipelineIndex) const
+    {
+        auto cores = audioCores;
+        const int callbackCore = getPipelineCore (pipelineIndex);
+
+        if (cores.contains (callbackCore))
+            cores.removeFirstMatchingValue (callbackCore);
+        else if (! cores.isEmpty())
+            cores.removeLast();
+
+        return cores;
+    }
+
+    // State that changes at runtime, such as each pipeline's device setup.
+    static std::unique_ptr<juce::XmlElement> loadXml (const juce::String& key)
+    {
+        juce::PropertiesFile props (getFileOptions());
+        return props.getXmlValue (key);
+    }
+
+    static void storeXml (const juce::String& key, const juce::XmlElement& xml)
+    {
+        juce::PropertiesFile props (getFileOptions());
+        props.setValue (key, &xml);
+        props.saveIfNeeded();
+    }
+
+private:
+    static juce::Array<int> parseIntList (const juce::String& text)
+    {
+        juce::Array<int> values;
+
+        for (auto& token : juce::StringArray::fromTokens (text, ",", {}))
+            if (token.trim().isNotEmpty())
+                values.add (token.trim().getIntValue());
+
+        return values;
+    }
+
+    static juce::Array<int> parseChannelList (const juce::String& text, int firstAllowed)
+    {
+        juce::Array<int> channels;
+
+        for (auto channel : parseIntList (text))
+            if (channel >= firstAllowed && channel < maxDeviceChannels && ! channels.contains (channel))
+                channels.add (channel);
+
+        return channels;
+    }
+
+    static int getHighest (const juce::Array<int>& values) noexcept
+    {
+        int highest = values.getFirst();
+
+        for (auto value : values)
+            highest = juce::jmax (highest, value);
+
+        return highest;
+    }
+
+    static constexpr int maxDeviceChannels = 64;
+
+    static int readInt (juce::PropertiesFile& props, const juce::String& key, int defaultValue)
+    {
+        if (! props.containsKey (key))
+            props.setValue (key, defaultValue);
+
+        return props.getIntValue (key, defaultValue);
+    }
+
+    static juce::String readString (juce::PropertiesFile& props, const juce::String& key, const juce::String& defaultValue)
+    {
+        if (! props.containsKey (key))
+            props.setValue (key, defaultValue);
+
+        return props.getValue (key, defaultValue);
+    }
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// AudioPluginInstance only takes HostedParameters, so the processors we host in-process
+// use this instead of AudioParameterFloat. The value is stored normalised and can be
+// read from the render thread at any time.
+class HostedFloatParameter  : public juce::AudioPluginInstance::HostedParameter
+{
+public:
+    HostedFloatParameter (const juce::String& parameterID, const juce::String& parameterName,
+                          juce::NormalisableRange<float> valueRange, float defaultPlainValue,
+                          const juce::String& parameterLabel)
+        : id (parameterID), name (parameterName), label (parameterLabel), range (valueRange),
+          defaultValue (range.convertTo0to1 (defaultPlainValue)), value (defaultValue)
+    {
+    }
+
+    // The plain value, in the parameter's own units.
+    float get() const noexcept                      { return range.convertFrom0to1 (value.load (std::memory_order_relaxed)); }
+    float convertTo0to1 (float plain) const         { return range.convertTo0to1 (range.snapToLegalValue (plain)); }
+
+    float getValue() const override                 { return value.load (std::memory_order_relaxed); }
+    void setValue (float newValue) override         { value.store (juce::jlimit (0.0f, 1.0f, newValue), std::memory_order_relaxed); }
+    float getDefaultValue() const override          { return defaultValue; }
+    juce::String getName (int maximumStringLength) const override   { return name.substring (0, maximumStringLength); }
+    juce::String getLabel() const override          { return label; }
+    juce::String getParameterID() const override    { return id; }
+
+    juce::String getText (float normalised, int) const override
+    {
+        return juce::String (range.convertFrom0to1 (normalised), 2);
+    }
+
+    float getValueForText (const juce::String& text) const override
+    {
+        return convertTo0to1 (text.getFloatValue());
+    }
+
+private:
+    const juce::String id, name, label;
+    const juce::NormalisableRange<float> range;
+    const float defaultValue;
+    std::atomic<float> value;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HostedFloatParameter)
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Fixed-capacity single-producer/single-consumer queue of small trivially copyable
+// items. Neither side locks or allocates once constructed.
+template <typename Item>
+class LockFreeQueue
+{
+public:
+    explicit LockFreeQueue (int capacity)
+        : fifo (capacity + 1), items ((size_t) capacity + 1)
+    {
+    }
+
+    // Producer side. Returns false if the queue is full.
+    bool push (const Item& item) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+            return false;
+
+        items[(size_t) start1] = item;
+        fifo.finishedWrite (1);
+        return true;
+    }
+
+    // Consumer side.
+    bool peek (Item& item) const noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+            return false;
+
+        item = items[(size_t) start1];
+        return true;
+    }
+
+    bool pop (Item& item) noexcept
+    {
+        if (! peek (item))
+            return false;
+
+        fifo.finishedRead (1);
+        return true;
+    }
+
+    void discardAll() noexcept                { fifo.finishedRead (fifo.getNumReady()); }
+    int getNumReady() const noexcept          { return fifo.getNumReady(); }
+    int getFreeSpace() const noexcept         { return fifo.getFreeSpace(); }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<Item> items;
+
+    JUCE_DECLARE_NON_COPYABLE (LockFreeQueue)
+};
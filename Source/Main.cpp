@@ -77,10 +77,7 @@ public:
             if (auto* mc = dynamic_cast<MainComponent*> (getContentComponent()))
             {
                 if (_pluginPath.isNotEmpty())
-                {
-                    juce::String err;
-                    mc->loadPluginFile (juce::File (_pluginPath), err);
-                }
+                    mc->loadPluginFile (juce::File (_pluginPath));
             }
 
             setVisible (true);
@@ -3,11 +3,18 @@
 //==============================================================================
 MainComponent::MainComponent()
 {
+    // Before any audio or worker thread exists, so they all start from the UI core set.
+    RealtimeScheduling::configure (settings);
+    MemoryResidency::configure (settings);
+
     setWantsKeyboardFocus (true);
     startTimerHz (30); // drive background animation
+    housekeepingTimer.startTimerHz (30);
 
     addAndMakeVisible (meterInput);
     addAndMakeVisible (meterOutput);
+    meterInput.setNumChannels (settings.numChannels);
+    meterOutput.setNumChannels (settings.numChannels);
     meterInput.setColours (juce::Colour::fromRGB (0x27, 0xe8, 0xff),  // glow
                            juce::Colour::fromRGB (0x1f, 0xc7, 0xff),  // fill
                            juce::Colour::fromRGB (0x0a, 0x0c, 0x12)); // back
@@ -16,11 +23,35 @@ MainComponent::MainComponent()
                             juce::Colour::fromRGB (0x12, 0x0a, 0x14)); // back
 
     addAndMakeVisible (oscilloscope);
+    oscilloscope.setNumChannels (settings.numChannels);
+
+    addAndMakeVisible (engineStatus);
+    engineStatus.setFont (13.0f);
+    engineStatus.setJustificationType (juce::Justification::centredLeft);
+    engineStatus.setColour (juce::Label::textColourId, juce::Colour::fromRGB (0x74, 0xf0, 0xff));
+    engineStatus.setInterceptsMouseClicks (false, false);
 
     addAndMakeVisible (parameterGrid);
     parameterGrid.setVisible (false); // hide knobs for now
+    parameterGrid.onParameterChange = [this] (juce::AudioProcessorParameter& param, float value)
+    {
+        getSelectedPipeline().postParameterChange (param, value);
+    };
+    parameterGrid.onParameterGesture = [this] (juce::AudioProcessorParameter& param, bool starting)
+    {
+        // With MIDI learn armed, the control touched is the one the next controller drives.
+        if (starting && midiLearnButton.getToggleState())
+            getSelectedPipeline().learnMidi (param);
+
+        getSelectedPipeline().postParameterGesture (param, starting);
+    };
     addAndMakeVisible (loadButton);
     loadButton.onClick = [this] { handleManualLoad(); };
+    addChildComponent (builtInButton);
+    builtInButton.onClick = [this] { getSelectedPipeline().loadBuiltIn(); };
+    addChildComponent (loadProgressBar);
+    addChildComponent (cancelLoadButton);
+    cancelLoadButton.onClick = [this] { getSelectedPipeline().cancelLoad(); };
 
     addAndMakeVisible (bannerButtons);
     bannerButtons.onFullClicked ([this]
@@ -31,6 +62,89 @@ MainComponent::MainComponent()
     bannerButtons.onBypassToggled ([this] (bool enabled) { setBypass (enabled); });
     bannerButtons.onExitClicked ([] { juce::JUCEApplication::getInstance()->systemRequestedQuit(); });
 
+    for (int i = 0; i < settings.numPipelines; ++i)
+    {
+        auto pipeline = std::make_unique<AudioPipeline> (i, settings);
+        auto* p = pipeline.get();
+
+        p->onPluginChanged = [this, p]
+        {
+            if (p == &getSelectedPipeline())
+            {
+                parameterGrid.setProcessor (p->getEditorProcessor());
+                parameterGrid.setVisible (true);
+            }
+        };
+
+        p->onLoadStateChanged = [this] { updateButtonVisibility(); };
+
+        p->onLoadFailed = [p] (const juce::String& message)
+        {
+            juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon,
+                                                    p->getName() + ": load failed", message);
+        };
+
+        pipelineSelector.addItem (p->getName(), i + 1);
+        pipelines.push_back (std::move (pipeline));
+    }
+
+    // Tap a slot to recall it; tap Store first to snapshot the plugin into it instead.
+    for (int slot = 0; slot < PresetBank::numSlots; ++slot)
+    {
+        auto& button = presetButtons[(size_t) slot];
+        button.setButtonText (PresetBank::getSlotName (slot));
+        button.setColour (juce::TextButton::buttonOnColourId, juce::Colour::fromRGB (0xff, 0x2f, 0xd0));
+        button.onClick = [this, slot] { handlePresetClick (slot); };
+        addAndMakeVisible (button);
+    }
+
+    storePresetButton.setClickingTogglesState (true);
+    storePresetButton.setColour (juce::TextButton::buttonOnColourId, juce::Colour::fromRGB (0x27, 0xe8, 0xff));
+    addAndMakeVisible (storePresetButton);
+
+    midiLearnButton.setClickingTogglesState (true);
+    midiLearnButton.setColour (juce::TextButton::buttonOnColourId, juce::Colour::fromRGB (0x27, 0xe8, 0xff));
+    midiLearnButton.onClick = [this]
+    {
+        if (! midiLearnButton.getToggleState())
+            getSelectedPipeline().cancelMidiLearn();
+    };
+    addChildComponent (midiLearnButton);
+
+    recordButton.setClickingTogglesState (true);
+    recordButton.setColour (juce::TextButton::buttonOnColourId, juce::Colour::fromRGB (0xff, 0x2f, 0xd0));
+    recordButton.onClick = [this]
+    {
+        auto& pipeline = getSelectedPipeline();
+
+        if (! recordButton.getToggleState())
+        {
+            pipeline.stopRecording();
+            return;
+        }
+
+        auto error = pipeline.startRecording();
+
+        if (error.isNotEmpty())
+        {
+            recordButton.setToggleState (false, juce::dontSendNotification);
+            juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon,
+                                                    pipeline.getName() + ": recording failed", error);
+        }
+
+        statusCountdown = 0;
+    };
+    addAndMakeVisible (recordButton);
+
+    addAndMakeVisible (morphPad);
+    morphPad.onMove = [this] (float x, float y) { getSelectedPipeline().setMorphPosition (x, y); };
+
+    addChildComponent (pipelineSelector);
+    pipelineSelector.setVisible (pipelines.size() > 1);
+    pipelineSelector.setSelectedId (1, juce::dontSendNotification);
+    pipelineSelector.onChange = [this] { selectPipeline (pipelineSelector.getSelectedId() - 1); };
+    pipelines.front()->setScope (&oscilloscope);
+
     // Make sure you set the size of the component after
     // you add any child components.
     setSize (1024, 600);
@@ -40,12 +154,12 @@ MainComponent::MainComponent()
         && ! juce::RuntimePermissions::isGranted (juce::RuntimePermissions::recordAudio))
     {
         juce::RuntimePermissions::request (juce::RuntimePermissions::recordAudio,
-                                           [&] (bool granted) { setAudioChannels (granted ? 2 : 0, 2); });
+                                           [&] (bool granted) { startPipelines (granted ? settings.getNumDeviceInputs() : 0); });
     }
     else
     {
         // Specify the number of input and output channels that we want to open
-        setAudioChannels (2, 2);
+        startPipelines (settings.getNumDeviceInputs());
     }
 
     updateButtonVisibility();
@@ -53,162 +167,52 @@ MainComponent::MainComponent()
 
 MainComponent::~MainComponent()
 {
-    // This shuts down the audio device and clears the audio source.
-    shutdownAudio();
-}
+    housekeepingTimer.stopTimer();
 
-bool MainComponent::loadPluginFile (const juce::File& pluginFile, juce::String& errorMessage)
-{
-    const double sr = currentSampleRate > 0.0 ? currentSampleRate : 44100.0;
-    const int bs = currentBlockSize > 0 ? currentBlockSize : 512;
+    // This shuts down the audio devices and clears the audio sources.
+    for (auto& pipeline : pipelines)
+        pipeline->shutdown();
 
-    pluginPrepared = false;
     parameterGrid.setProcessor (nullptr);
-    parameterGrid.setVisible (false);
-
-    if (! pluginLoader.load (pluginFile, sr, bs, errorMessage))
-        return false;
-
-    if (auto* processor = pluginLoader.get(); processor != nullptr && currentSampleRate > 0.0 && currentBlockSize > 0)
-    {
-        processor->setPlayConfigDetails (2, 2, currentSampleRate, currentBlockSize);
-        processor->prepareToPlay (currentSampleRate, currentBlockSize);
-        pluginPrepared = true;
-    }
-
-    parameterGrid.setProcessor (pluginLoader.get());
-    parameterGrid.setVisible (true);
-    showLoadButton = false;
-    updateButtonVisibility();
-
-    return true;
 }
 
-//==============================================================================
-void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+void MainComponent::startPipelines (int numInputChannels)
 {
-    currentSampleRate = sampleRate;
-    currentBlockSize = samplesPerBlockExpected;
-    pluginPrepared = false;
-
-    if (! autoLoadAttempted)
-    {
-        autoLoadAttempted = true;
-        juce::File exe = juce::File::getSpecialLocation (juce::File::currentExecutableFile);
-        
-        juce::Array<juce::File> candidates;
-        candidates.add (exe.getSiblingFile ("Stardust.dll"));
-        candidates.add (exe.getParentDirectory().getChildFile ("Resources").getChildFile ("Stardust.dll"));
-        candidates.add (juce::File::getCurrentWorkingDirectory().getChildFile ("Stardust.dll"));
-
-        bool loaded = false;
-        for (const auto& stardust : candidates)
-        {
-            if (stardust.existsAsFile())
-            {
-                juce::String err;
-                if (loadPluginFile (stardust, err))
-                {
-                    loaded = true;
-                    break;
-                }
-            }
-        }
-
-        if (! loaded)
-        {
-            showLoadButton = true;
-            updateButtonVisibility();
-        }
-    }
-
-    if (pluginLoader.isLoaded())
-    {
-        if (auto* processor = pluginLoader.get())
-        {
-            processor->setPlayConfigDetails (2, 2, sampleRate, samplesPerBlockExpected);
-            processor->prepareToPlay (sampleRate, samplesPerBlockExpected);
-            pluginPrepared = true;
-        }
-    }
+    for (auto& pipeline : pipelines)
+        pipeline->start (numInputChannels, settings.getNumDeviceOutputs());
 }
 
-void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
+void MainComponent::selectPipeline (int pipelineIndex)
 {
-    if (pluginPrepared && pluginLoader.isLoaded())
-    {
-        auto* buffer = bufferToFill.buffer;
-        const int numSamples = buffer->getNumSamples();
-        const int numChannels = buffer->getNumChannels();
+    if (! juce::isPositiveAndBelow (pipelineIndex, (int) pipelines.size()) || pipelineIndex == selectedPipeline)
+        return;
 
-        double sumSquaresIn[2] { 0.0, 0.0 };
-        for (int ch = 0; ch < numChannels && ch < 2; ++ch)
-        {
-            const float* data = buffer->getReadPointer (ch);
-            for (int i = 0; i < numSamples; ++i)
-                sumSquaresIn[ch] += data[i] * data[i];
-        }
-        const double denom = juce::jmax (1, numSamples);
-        const float rmsInL = (float) std::sqrt (sumSquaresIn[0] / denom);
-        const float rmsInR = (float) std::sqrt (sumSquaresIn[1] / denom);
+    getSelectedPipeline().setScope (nullptr);
+    selectedPipeline = pipelineIndex;
 
-        float rmsOutL = rmsInL;
-        float rmsOutR = rmsInR;
-
-        if (! bypassEnabled)
-        {
-            juce::MidiBuffer midi;
-            pluginLoader.get()->processBlock (*buffer, midi);
+    auto& pipeline = getSelectedPipeline();
+    pipeline.setScope (&oscilloscope);
+    parameterGrid.setProcessor (pipeline.getEditorProcessor());
+    parameterGrid.setVisible (pipeline.hasPlugin());
+    bannerButtons.setBypassState (pipeline.isBypassed());
+    morphPad.setPosition (pipeline.getMorphPosition());
 
-            double sumSquaresOut[2] { 0.0, 0.0 };
-            for (int ch = 0; ch < numChannels && ch < 2; ++ch)
-            {
-                const float* data = buffer->getReadPointer (ch);
-                for (int i = 0; i < numSamples; ++i)
-                    sumSquaresOut[ch] += data[i] * data[i];
-            }
-            rmsOutL = (float) std::sqrt (sumSquaresOut[0] / denom);
-            rmsOutR = (float) std::sqrt (sumSquaresOut[1] / denom);
-        }
-
-        rmsInput[0].store (rmsInL);
-        rmsInput[1].store (rmsInR);
-        rmsOutput[0].store (rmsOutL);
-        rmsOutput[1].store (rmsOutR);
-
-        const float maxOut = juce::jmax (rmsOutL, rmsOutR);
-        tonalEnergy.store (juce::jlimit (0.0f, 1.0f, maxOut * 2.0f));
-
-        const float envelope = 0.5f * (rmsOutL + rmsOutR);
-        const float delta = juce::jmax (0.0f, envelope - prevEnergy);
-        prevEnergy = envelope * 0.9f + prevEnergy * 0.1f;
-        rhythmEnergy.store (juce::jlimit (0.0f, 1.0f, delta * 8.0f));
-
-        if (buffer->getNumChannels() > 0)
-            oscilloscope.pushSamples (buffer->getReadPointer (0), numSamples);
-    }
-    else
+    // A learn armed on the zone we're leaving is dropped with it.
+    if (midiLearnButton.getToggleState())
     {
-        bufferToFill.clearActiveBufferRegion();
-        rmsInput[0].store (0.0f);
-        rmsInput[1].store (0.0f);
-        rmsOutput[0].store (0.0f);
-        rmsOutput[1].store (0.0f);
-        tonalEnergy.store (0.0f);
-        rhythmEnergy.store (0.0f);
-        prevEnergy = 0.0f;
+        for (auto& p : pipelines)
+            p->cancelMidiLearn();
+
+        midiLearnButton.setToggleState (false, juce::dontSendNotification);
     }
+
+    statusCountdown = 0;
+    updateButtonVisibility();
 }
 
-void MainComponent::releaseResources()
+void MainComponent::loadPluginFile (const juce::File& pluginFile)
 {
-    if (pluginPrepared && pluginLoader.isLoaded())
-    {
-        if (auto* processor = pluginLoader.get())
-            processor->releaseResources();
-    }
-
-    pluginPrepared = false;
+    getSelectedPipeline().loadPluginFiles ({ pluginFile }, true);
 }
 
 //==============================================================================
@@ -295,16 +299,28 @@ void MainComponent::resized()
     const int buttonSize = juce::jmax (24, (int) (bannerHeight * 0.6f));
     bannerButtons.setBounds (bannerArea.removeFromRight (buttonSize * 4 + 32));
     bannerButtons.setButtonSize (buttonSize);
+    pipelineSelector.setBounds (bannerArea.removeFromRight (140).withSizeKeepingCentre (140, buttonSize));
+
+    for (int slot = PresetBank::numSlots; --slot >= 0;)
+        presetButtons[(size_t) slot].setBounds (bannerArea.removeFromRight (buttonSize + 6).withSizeKeepingCentre (buttonSize, buttonSize));
+
+    storePresetButton.setBounds (bannerArea.removeFromRight (70).withSizeKeepingCentre (64, buttonSize));
+    recordButton.setBounds (bannerArea.removeFromRight (70).withSizeKeepingCentre (64, buttonSize));
+    midiLearnButton.setBounds (bannerArea.removeFromRight (96).withSizeKeepingCentre (90, buttonSize));
 
     auto content = area;
 
-    const int meterWidth = juce::jmax (16, area.getWidth() / 30);
+    // Meters widen with the channel count so each bar stays readable.
+    const int meterWidth = juce::jmin (area.getWidth() / 6,
+                                       juce::jmax (16, area.getWidth() / 30) * juce::jmax (1, settings.numChannels / 4));
     meterInput.setBounds (content.removeFromLeft (meterWidth).reduced (4, 6));
     meterOutput.setBounds (content.removeFromRight (meterWidth).reduced (4, 6));
 
     const int oscHeight = 140;
     auto oscArea = content.removeFromBottom (oscHeight).reduced (8, 6);
+    morphPad.setBounds (oscArea.removeFromRight (oscArea.getHeight()).withTrimmedLeft (8));
     oscilloscope.setBounds (oscArea);
+    engineStatus.setBounds (content.removeFromBottom (20).reduced (8, 0));
 
     parameterGrid.setBounds (content.reduced (8));
 
@@ -312,12 +328,25 @@ void MainComponent::resized()
     auto buttonBounds = juce::Rectangle<int> (buttonSize2, buttonSize2)
                             .withCentre (area.getCentre());
     loadButton.setBounds (buttonBounds);
+    builtInButton.setBounds (juce::Rectangle<int> (juce::jmax (buttonSize2, 120), 30)
+                                 .withCentre ({ buttonBounds.getCentreX(), buttonBounds.getBottom() + 27 }));
+
+    auto progressBounds = juce::Rectangle<int> (juce::jmin (420, area.getWidth() - 40), 30)
+                              .withCentre (area.getCentre());
+    cancelLoadButton.setBounds (progressBounds.removeFromRight (90));
+    loadProgressBar.setBounds (progressBounds.withTrimmedRight (8));
 }
 
 void MainComponent::updateButtonVisibility()
 {
-    loadButton.setVisible (showLoadButton);
+    auto& pipeline = getSelectedPipeline();
+
+    loadButton.setVisible (pipeline.isAwaitingManualLoad());
     loadButton.toFront (false);
+    builtInButton.setVisible (pipeline.isAwaitingManualLoad());
+    builtInButton.toFront (false);
+    loadProgressBar.setVisible (pipeline.isLoadInProgress());
+    cancelLoadButton.setVisible (pipeline.isLoadInProgress());
 }
 
 void MainComponent::handleManualLoad()
@@ -328,36 +357,22 @@ void MainComponent::handleManualLoad()
     fileChooser->launchAsync (flags, [this] (const juce::FileChooser& chooserRef)
     {
         auto chosen = chooserRef.getResult();
-        juce::String err;
 
-        if (chosen.existsAsFile() && loadPluginFile (chosen, err))
-        {
-            showLoadButton = false;
-        }
-        else
-        {
-            showLoadButton = true;
-            if (err.isEmpty())
-                err = "Failed to load plugin.";
-            juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon, "Load failed", err);
-        }
+        if (chosen != juce::File())
+            loadPluginFile (chosen);
 
-        updateButtonVisibility();
         fileChooser.reset();
     });
 }
 
 void MainComponent::showAudioSettings()
 {
-    auto component = std::make_unique<juce::AudioDeviceSelectorComponent> (deviceManager,
-                                                                           0, 2,  // min/max inputs
-                                                                           0, 2,  // min/max outputs
-                                                                           true, true, true, false);
-    component->setSize (500, 400);
+    auto component = std::make_unique<AudioSettingsPanel> (getSelectedPipeline(), settings);
 
     juce::DialogWindow::LaunchOptions options;
     options.content.setOwned (component.release());
-    options.dialogTitle = "Audio Settings";
+    options.dialogTitle = pipelines.size() > 1 ? "Audio Settings - " + getSelectedPipeline().getName()
+                                               : juce::String ("Audio Settings");
     
     // Customization: Set the background colour to match your MainComponent's gradient start colour
     options.dialogBackgroundColour = juce::Colour::fromRGB (11, 16, 24);
@@ -369,18 +384,71 @@ void MainComponent::showAudioSettings()
     options.launchAsync();
 }
 
+// Engine housekeeping for every pipeline. It runs at a fixed rate whatever the visuals are
+// doing: retired plugins, preset recalls, parameter notifications and diagnostics must
+// not slow down just because nothing is worth animating.
+void MainComponent::runHousekeeping()
+{
+    for (auto& p : pipelines)
+    {
+        p->dispatchParameterNotifications();
+        p->updatePresets();
+
+        if (p->updateMidiLearn() && p.get() == &getSelectedPipeline())
+            midiLearnButton.setToggleState (false, juce::dontSendNotification);
+    }
+
+    updatePresetButtons();
+
+    auto& pipeline = getSelectedPipeline();
+
+    if (pipeline.isIdle() != visualsIdle)
+        setVisualsIdle (pipeline.isIdle());
+
+    if (--statusCountdown <= 0)
+    {
+        statusCountdown = 15;
+
+        for (auto& p : pipelines)
+            p->pollDiagnostics();
+
+        auto schedulingReport = RealtimeScheduling::takeReport();
+
+        if (schedulingReport.isNotEmpty())
+            juce::Logger::writeToLog ("Real-time scheduling: " + schedulingReport);
+
+        updateEngineStatus();
+    }
+
+    const auto& loader = pipeline.getLoader();
+
+    if (pipeline.isLoadInProgress() && loader.isLoading())
+    {
+        loadProgress = loader.getProgress();
+        loadProgressBar.setTextToDisplay (SinglePluginLoader::getStageName (loader.getStage())
+                                          + "... " + juce::String (loader.getElapsedSeconds(), 1) + " s");
+    }
+}
+
+// Animation only; its rate follows setVisualsIdle.
 void MainComponent::timerCallback()
 {
     gradientPhase += 0.7f; // advance animation
     if (gradientPhase > juce::MathConstants<float>::twoPi)
         gradientPhase -= juce::MathConstants<float>::twoPi;
-    
-    meterInput.setTargetLevels (rmsInput[0].load(), rmsInput[1].load());
-    meterOutput.setTargetLevels (rmsOutput[0].load(), rmsOutput[1].load());
+
+    auto& pipeline = getSelectedPipeline();
+
+    for (int ch = 0; ch < pipeline.getNumChannels(); ++ch)
+    {
+        meterInput.setTargetLevel (ch, pipeline.getInputLevel (ch));
+        meterOutput.setTargetLevel (ch, pipeline.getOutputLevel (ch));
+    }
+
     meterInput.tick (0.18f);
     meterOutput.tick (0.18f);
-    bannerEnergy = bannerEnergy * 0.9f + tonalEnergy.load() * 0.1f;
-    bannerRhythm = bannerRhythm * 0.85f + rhythmEnergy.load() * 0.15f;
+    bannerEnergy = bannerEnergy * 0.9f + pipeline.getTonalEnergy() * 0.1f;
+    bannerRhythm = bannerRhythm * 0.85f + pipeline.getRhythmEnergy() * 0.15f;
     oscilloscope.repaint();
     repaint();
 }
@@ -407,5 +475,75 @@ void MainComponent::toggleFullScreen()
 
 void MainComponent::setBypass (bool shouldBypass)
 {
-    bypassEnabled = shouldBypass;
+    getSelectedPipeline().setBypass (shouldBypass);
+}
+
+void MainComponent::handlePresetClick (int slot)
+{
+    auto& pipeline = getSelectedPipeline();
+
+    if (storePresetButton.getToggleState())
+    {
+        pipeline.storePreset (slot);
+        storePresetButton.setToggleState (false, juce::dontSendNotification);
+    }
+    else
+    {
+        pipeline.recallPreset (slot);
+    }
+
+    updatePresetButtons();
+}
+
+void MainComponent::updatePresetButtons()
+{
+    auto& pipeline = getSelectedPipeline();
+    const bool storing = storePresetButton.getToggleState();
+
+    storePresetButton.setEnabled (pipeline.hasPlugin());
+    std::array<bool, (size_t) PresetBank::numSlots> available {};
+
+    for (int slot = 0; slot < PresetBank::numSlots; ++slot)
+    {
+        auto& button = presetButtons[(size_t) slot];
+        button.setEnabled (pipeline.hasPlugin() && (storing || pipeline.hasPreset (slot)));
+        button.setToggleState (slot == pipeline.getCurrentPreset(), juce::dontSendNotification);
+        available[(size_t) slot] = pipeline.hasPreset (slot);
+    }
+
+    morphPad.setAvailableSlots (available);
+    morphPad.setEnabled (pipeline.canMorph());
+
+    midiLearnButton.setVisible (pipeline.hasMidiInput());
+    midiLearnButton.setEnabled (pipeline.hasPlugin());
+
+    // The recording can also end on its own, when the device changes rate.
+    recordButton.setToggleState (pipeline.isRecording(), juce::dontSendNotification);
+}
+
+// While the plugin is idled by the silence gate there is nothing worth animating, so
+// every UI timer drops to a trickle. The housekeeping timer keeps its rate.
+void MainComponent::setVisualsIdle (bool shouldIdle)
+{
+    visualsIdle = shouldIdle;
+    startTimerHz (shouldIdle ? 4 : 30);
+    oscilloscope.setRefreshRate (shouldIdle ? 2 : 60);
+    parameterGrid.setRefreshRate (shouldIdle ? 2 : 30);
+    statusCountdown = 0;
+}
+
+void MainComponent::updateEngineStatus()
+{
+    auto items = getSelectedPipeline().getStatusItems();
+    auto scheduling = RealtimeScheduling::getSummary();
+
+    if (scheduling.isNotEmpty())
+        items.insert (0, scheduling);
+
+    auto residency = MemoryResidency::getSummary();
+
+    if (residency.isNotEmpty())
+        items.insert (0, residency);
+
+    engineStatus.setText (items.joinIntoString ("   |   "), juce::dontSendNotification);
 }
@@ -0,0 +1,301 @@
+#include "MemoryResidency.h"
+#include <cstring>
+
+#if JUCE_LINUX || JUCE_BSD
+ #include <sys/mman.h>
+ #include <sys/resource.h>
+ #include <unistd.h>
+ #include <cerrno>
+ #include <cstdio>
+ #include <fstream>
+ #include <string>
+#elif JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #include <windows.h>
+#endif
+
+#if JUCE_MSVC
+ #define STARNAILS_NOINLINE __declspec (noinline)
+#else
+ #define STARNAILS_NOINLINE __attribute__ ((noinline))
+#endif
+
+namespace
+{
+    // Written once by configure() before any audio thread starts, read-only afterwards.
+    struct State
+    {
+        bool enabled = false;
+        bool locked = false;
+        bool futureLocked = false;      // new mappings are locked as they are made
+        size_t pageSize = 4096;
+        juce::String lockError;
+
+        std::atomic<bool> refreshFailed { false };
+    };
+
+    State& getState()
+    {
+        static State state;
+        return state;
+    }
+
+    // Deeper than anything the render path needs, well inside every platform's default.
+    constexpr size_t stackPrefaultBytes = 128 * 1024;
+
+    STARNAILS_NOINLINE void touchStackPages (size_t pageSize) noexcept
+    {
+        volatile char block[stackPrefaultBytes];
+
+        for (size_t i = 0; i < stackPrefaultBytes; i += pageSize)
+            block[i] = 0;
+
+        block[stackPrefaultBytes - 1] = 0;
+    }
+
+    void touchPagesForWriting (void* start, size_t numBytes, size_t pageSize) noexcept
+    {
+        if (start == nullptr || numBytes == 0)
+            return;
+
+        auto* bytes = static_cast<volatile char*> (start);
+
+        for (size_t i = 0; i < numBytes; i += pageSize)
+            bytes[i] = bytes[i];
+
+        bytes[numBytes - 1] = bytes[numBytes - 1];
+
+       #if JUCE_WINDOWS
+        if (getState().locked)
+            VirtualLock (start, numBytes);
+       #endif
+    }
+
+    void touchPagesForReading (const void* start, size_t numBytes, size_t pageSize) noexcept
+    {
+        auto* bytes = static_cast<const volatile char*> (start);
+        char sink = 0;
+
+        for (size_t i = 0; i < numBytes; i += pageSize)
+            sink ^= bytes[i];
+
+        juce::ignoreUnused (sink);
+    }
+
+   #if JUCE_LINUX || JUCE_BSD
+    juce::String describeLockError (int error)
+    {
+        if (error == EPERM)
+            return "EPERM (not permitted: grant CAP_IPC_LOCK or raise memlock in /etc/security/limits.conf)";
+
+        if (error == ENOMEM)
+            return "ENOMEM (more memory than the memlock limit allows: raise memlock in /etc/security/limits.conf)";
+
+        return "error " + juce::String (error) + " (" + juce::String (std::strerror (error)) + ")";
+    }
+   #endif
+}
+
+//==============================================================================
+void MemoryResidency::configure (const EngineSettings& settings)
+{
+    auto& state = getState();
+    state.enabled = settings.lockMemory;
+
+   #if JUCE_LINUX || JUCE_BSD
+    state.pageSize = (size_t) juce::jmax (4096L, sysconf (_SC_PAGESIZE));
+   #elif JUCE_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo (&info);
+    state.pageSize = (size_t) juce::jmax ((DWORD) 4096, info.dwPageSize);
+   #endif
+
+    if (! state.enabled)
+        return;
+
+   #if JUCE_LINUX || JUCE_BSD
+    // MCL_FUTURE makes any mapping past the limit fail outright, including ordinary
+    // allocations, so it is only used when nothing can hit the limit.
+    rlimit limit;
+    const bool unlimited = geteuid() == 0
+                            || (getrlimit (RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY);
+
+    if (mlockall (MCL_CURRENT | (unlimited ? MCL_FUTURE : 0)) == 0)
+    {
+        state.locked = true;
+        state.futureLocked = unlimited;
+    }
+    else
+    {
+        state.lockError = "mlockall refused: " + describeLockError (errno);
+    }
+   #elif JUCE_WINDOWS
+    // Locked pages count against the working-set minimum, so make room for the plugin
+    // and the render buffers before anything is locked.
+    SIZE_T minimumSize = 0, maximumSize = 0;
+    auto process = GetCurrentProcess();
+    constexpr SIZE_T extra = (SIZE_T) 256 * 1024 * 1024;
+
+    if (GetProcessWorkingSetSize (process, &minimumSize, &maximumSize)
+        && SetProcessWorkingSetSize (process, minimumSize + extra, juce::jmax (maximumSize, minimumSize + extra) + extra))
+        state.locked = true;
+    else
+        state.lockError = "working set could not be raised (error " + juce::String ((int) GetLastError()) + ")";
+   #else
+    state.lockError = "memory locking is not supported on this platform";
+   #endif
+
+    juce::Logger::writeToLog ("Memory residency: " + (state.locked ? getSummary() : state.lockError));
+}
+
+bool MemoryResidency::isEnabled() noexcept
+{
+    return getState().enabled;
+}
+
+juce::String MemoryResidency::getSummary()
+{
+    auto& state = getState();
+
+    if (! state.enabled)
+        return {};
+
+    if (! state.locked)
+        return "Memory lock REFUSED";
+
+    if (state.refreshFailed.load())
+        return "Memory partly locked";
+
+    return "Memory locked";
+}
+
+void MemoryResidency::refresh()
+{
+   #if JUCE_LINUX || JUCE_BSD
+    auto& state = getState();
+
+    if (! state.locked || state.futureLocked)
+        return;
+
+    if (mlockall (MCL_CURRENT) != 0 && ! state.refreshFailed.exchange (true))
+        juce::Logger::writeToLog ("Memory residency: locking new mappings refused: " + describeLockError (errno));
+   #endif
+}
+
+void MemoryResidency::touchModule (const juce::File& moduleFile)
+{
+    auto& state = getState();
+
+    if (! state.enabled)
+        return;
+
+   #if JUCE_LINUX || JUCE_BSD
+    // The loader has mapped the module by now; find its mappings by path.
+    const auto path = moduleFile.getFullPathName();
+    const auto target = moduleFile.getLinkedTarget().getFullPathName();
+    std::ifstream maps ("/proc/self/maps");
+    std::string line;
+
+    while (std::getline (maps, line))
+    {
+        const juce::String text (line);
+
+        if (! (text.endsWith (path) || text.endsWith (target)))
+            continue;
+
+        unsigned long start = 0, end = 0;
+        char permissions[5] = {};
+
+        if (std::sscanf (line.c_str(), "%lx-%lx %4s", &start, &end, permissions) == 3 && permissions[0] == 'r')
+            touchPagesForReading (reinterpret_cast<const void*> (start), (size_t) (end - start), state.pageSize);
+    }
+   #elif JUCE_WINDOWS
+    auto* base = reinterpret_cast<const char*> (GetModuleHandleW (moduleFile.getFullPathName().toWideCharPointer()));
+
+    if (base == nullptr)
+        return;
+
+    auto* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*> (base);
+    auto* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*> (base + dosHeader->e_lfanew);
+    const size_t imageSize = ntHeaders->OptionalHeader.SizeOfImage;
+
+    // Walk region by region, skipping anything that isn't readable.
+    for (size_t offset = 0; offset < imageSize;)
+    {
+        MEMORY_BASIC_INFORMATION region;
+
+        if (VirtualQuery (base + offset, &region, sizeof (region)) == 0)
+            break;
+
+        const auto regionEnd = juce::jmin (imageSize, (size_t) (static_cast<const char*> (region.BaseAddress) - base) + region.RegionSize);
+        const bool readable = region.State == MEM_COMMIT && (region.Protect & (PAGE_NOACCESS | PAGE_GUARD)) == 0;
+
+        if (readable)
+        {
+            touchPagesForReading (base + offset, regionEnd - offset, state.pageSize);
+
+            if (state.locked)
+                VirtualLock (const_cast<char*> (base + offset), regionEnd - offset);
+        }
+
+        offset = regionEnd;
+    }
+   #else
+    juce::ignoreUnused (moduleFile);
+   #endif
+}
+
+void MemoryResidency::prefault (juce::AudioBuffer<float>& buffer) noexcept
+{
+    auto& state = getState();
+
+    if (! state.enabled)
+        return;
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        touchPagesForWriting (buffer.getWritePointer (ch), sizeof (float) * (size_t) buffer.getNumSamples(), state.pageSize);
+}
+
+void MemoryResidency::prefaultStack() noexcept
+{
+    if (getState().enabled)
+        touchStackPages (getState().pageSize);
+}
+
+//==============================================================================
+bool MemoryResidency::FaultCounter::isSupported() noexcept
+{
+   #if JUCE_LINUX
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+void MemoryResidency::FaultCounter::sample() noexcept
+{
+   #if JUCE_LINUX
+    rusage usage;
+
+    if (getrusage (RUSAGE_THREAD, &usage) != 0)
+        return;
+
+    const auto major = (juce::int64) usage.ru_majflt;
+    const auto minor = (juce::int64) usage.ru_minflt;
+
+    if (started)
+    {
+        majorFaults.fetch_add (major - lastMajor, std::memory_order_relaxed);
+        minorFaults.fetch_add (minor - lastMinor, std::memory_order_relaxed);
+    }
+
+    started = true;
+    lastMajor = major;
+    lastMinor = minor;
+   #endif
+}
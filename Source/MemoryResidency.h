@@ -0,0 +1,68 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "EngineSettings.h"
+#include <atomic>
+
+// Keeps the audio path resident in RAM, so the first blocks after startup or after a
+// long idle spell don't stall on page faults.
+//
+// When enabled, configure() locks the process memory (mlockall on Linux, a raised
+// working-set minimum on Windows). The render stages prefault their scratch buffers as
+// they are sized, audio threads prefault their stack when they start, and the loader
+// reads through the plugin module's mapped pages after it has been prepared. With the
+// mode off, all of these do nothing.
+//
+// FaultCounter measures what is left: the major and minor page faults taken by one
+// thread, where the OS can report them per thread (Linux).
+class MemoryResidency
+{
+public:
+    // Message thread, at startup.
+    static void configure (const EngineSettings& settings);
+
+    static bool isEnabled() noexcept;
+
+    // Message thread. Short status, e.g. "Memory locked", or an empty string.
+    static juce::String getSummary();
+
+    // Loader or message thread, after plugins have been created or prepared. Locks
+    // whatever has been mapped since configure() when future mappings aren't already
+    // locked.
+    static void refresh();
+
+    // Loader thread. Reads one byte of every page the plugin module has mapped.
+    static void touchModule (const juce::File& moduleFile);
+
+    // Message thread, while the audio callback is stopped. Writes every page of the
+    // buffer in place, so the contents are unchanged.
+    static void prefault (juce::AudioBuffer<float>& buffer) noexcept;
+
+    // Audio thread, when it starts. Touches the stack the render path will use.
+    static void prefaultStack() noexcept;
+
+    //==============================================================================
+    class FaultCounter
+    {
+    public:
+        static bool isSupported() noexcept;
+
+        // Message thread, while the measured thread is stopped. The next sample() takes
+        // a new baseline, since the device may call back on a different thread.
+        void restart() noexcept                     { started = false; }
+
+        // The measured thread only.
+        void sample() noexcept;
+
+        // Any thread. Totals over the session.
+        juce::int64 getMajorFaults() const noexcept { return majorFaults.load(); }
+        juce::int64 getMinorFaults() const noexcept { return minorFaults.load(); }
+
+    private:
+        bool started = false;
+        juce::int64 lastMajor = 0;
+        juce::int64 lastMinor = 0;
+        std::atomic<juce::int64> majorFaults { 0 };
+        std::atomic<juce::int64> minorFaults { 0 };
+    };
+};
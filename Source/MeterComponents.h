@@ -0,0 +1,208 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+class OscilloscopeComponent : public juce::Component, private juce::Timer
+{
+public:
+    OscilloscopeComponent()
+    {
+        setNumChannels(1);
+        startTimerHz(60); // smoother redraws
+    }
+
+    void setRefreshRate(int hz) { startTimerHz(hz); }
+
+    // Message thread. Each channel gets its own lane.
+    void setNumChannels(int numChannels)
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        buffers.assign((size_t)juce::jmax(1, numChannels), std::vector<float>(scopeSize, 0.0f));
+        writePos = 0;
+    }
+
+    void pushSamples(const float* const* channels, int numChannels, int numSamples)
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        const int lanes = juce::jmin(numChannels, (int)buffers.size());
+
+        for (int ch = 0; ch < lanes; ++ch)
+        {
+            auto& lane = buffers[(size_t)ch];
+            int pos = writePos;
+            for (int i = 0; i < numSamples; ++i)
+            {
+                lane[(size_t)pos] = channels[ch][i];
+                pos = (pos + 1) % (int)scopeSize;
+            }
+        }
+
+        writePos = (writePos + numSamples) % (int)scopeSize;
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        auto area = getLocalBounds().toFloat();
+        auto back = juce::Colour::fromRGB(0x0b, 0x10, 0x18);
+        auto panel = juce::Colour::fromRGB(0x1a, 0x10, 0x33);
+        auto glow = juce::Colour::fromRGB(0xff, 0x2f, 0xd0);
+        auto trace = juce::Colour::fromRGB(0x27, 0xe8, 0xff);
+
+        g.setColour(back.withAlpha(0.9f));
+        g.fillRoundedRectangle(area, 8.0f);
+        g.setColour(glow.withAlpha(0.4f));
+        g.drawRoundedRectangle(area, 8.0f, 1.6f);
+
+        {
+            const juce::SpinLock::ScopedLockType sl(lock);
+            snapshots.resize(buffers.size());
+            for (size_t ch = 0; ch < buffers.size(); ++ch)
+            {
+                snapshots[ch].resize(scopeSize);
+                int idx = writePos;
+                for (size_t i = 0; i < scopeSize; ++i)
+                {
+                    idx = (idx + 1) % scopeSize;
+                    snapshots[ch][i] = buffers[ch][(size_t)idx];
+                }
+            }
+        }
+
+        const size_t numLanes = snapshots.size();
+        const float laneHeight = area.getHeight() / (float)numLanes;
+        const float w = area.getWidth();
+
+        for (size_t ch = 0; ch < numLanes; ++ch)
+        {
+            auto& snapshot = snapshots[ch];
+
+            // simple smoothing for fluid visuals
+            for (size_t i = 1; i < snapshot.size(); ++i)
+                snapshot[i] = 0.6f * snapshot[i] + 0.4f * snapshot[i - 1];
+
+            juce::Path p;
+            const float midY = area.getY() + laneHeight * ((float)ch + 0.5f);
+            const float amp = laneHeight * 0.45f;
+            const size_t N = snapshot.size();
+            if (N == 0)
+                continue;
+
+            for (size_t i = 0; i < N; ++i)
+            {
+                const float x = (float)i / (float)(N - 1) * w + area.getX();
+                const float y = midY - snapshot[i] * amp;
+                if (i == 0) p.startNewSubPath(x, y);
+                else p.lineTo(x, y);
+            }
+
+            // alternate cyan and magenta between pairs
+            g.setColour(((ch / 2) % 2 == 0 ? trace : glow).withAlpha(0.95f));
+            g.strokePath(p, juce::PathStrokeType(numLanes > 4 ? 1.2f : 2.4f));
+        }
+    }
+
+private:
+    void timerCallback() override { repaint(); }
+
+    static constexpr size_t scopeSize = 1024;
+    std::vector<std::vector<float>> buffers;
+    std::vector<std::vector<float>> snapshots;
+    int writePos{ 0 };
+    juce::SpinLock lock;
+};
+
+// Simple neon-style VU meter component
+class VUMeter : public juce::Component
+{
+public:
+    void setNumChannels (int numChannels)
+    {
+        targetLevel.assign ((size_t) juce::jmax (1, numChannels), 0.0f);
+        currentLevel.assign (targetLevel.size(), 0.0f);
+        repaint();
+    }
+
+    int getNumChannels() const noexcept   { return (int) targetLevel.size(); }
+
+    void setTargetLevel (int channel, float level)
+    {
+        if (! juce::isPositiveAndBelow (channel, getNumChannels()))
+            return;
+
+        const float db = juce::Decibels::gainToDecibels (level, -80.0f);
+        targetLevel[(size_t) channel] = juce::jlimit (0.0f, 1.0f, (db + 80.0f) / 80.0f);
+    }
+
+    void setColours (juce::Colour glow, juce::Colour fill, juce::Colour back) noexcept
+    {
+        glowColour = glow;
+        fillColour = fill;
+        backColour = back;
+        repaint();
+    }
+
+    void tick (float smoothing)
+    {
+        for (size_t i = 0; i < targetLevel.size(); ++i)
+        {
+            const auto delta = targetLevel[i] - currentLevel[i];
+            currentLevel[i] += delta * smoothing;
+        }
+        repaint();
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto area = getLocalBounds().toFloat();
+        const auto border = 3.0f;
+        auto barArea = area.reduced (border);
+
+        g.setColour (backColour.withAlpha (0.6f));
+        g.fillRoundedRectangle (area, 6.0f);
+
+        g.setColour (glowColour.withAlpha (0.5f));
+        g.drawRoundedRectangle (area, 6.0f, 1.8f);
+
+        const int numBars = getNumChannels();
+        const float gap = numBars > 4 ? 1.0f : 4.0f;
+        const float barW = (barArea.getWidth() - gap * (float) (numBars - 1)) / (float) numBars;
+
+        for (int i = 0; i < numBars; ++i)
+        {
+            auto single = barArea.withWidth (barW).withX (barArea.getX() + (float) i * (barW + gap));
+            auto levelHeight = single.getHeight() * currentLevel[(size_t) i];
+            juce::Rectangle<float> levelRect { single.getX(),
+                                               single.getBottom() - levelHeight,
+                                               single.getWidth(),
+                                               levelHeight };
+
+            juce::ColourGradient grad (fillColour.brighter (0.3f), levelRect.getX(), levelRect.getY(),
+                                       fillColour.darker (0.2f), levelRect.getX(), levelRect.getBottom(), false);
+            grad.addColour (0.5f, glowColour.withAlpha (0.7f));
+            g.setGradientFill (grad);
+            g.fillRoundedRectangle (levelRect, 4.0f);
+        }
+
+        // dB scale ticks on the left
+        g.setColour (juce::Colours::white.withAlpha (0.55f));
+        g.setFont (10.0f);
+        const int dBMarks[] = { 0, -3, -6, -10, -20, -40, -60 }; // mapped to -80..0 range
+        for (int db : dBMarks)
+        {
+            const float norm = juce::jlimit (0.0f, 1.0f, (db + 80.0f) / 80.0f);
+            const float y = barArea.getBottom() - norm * barArea.getHeight();
+            const float x1 = area.getX() + 2.0f;
+            const float x2 = x1 + 6.0f;
+            g.drawLine (x1, y, x2, y, 1.0f);
+            g.drawText (juce::String (db), (int) x2 + 2, (int) (y - 6), 24, 12, juce::Justification::centredLeft, false);
+        }
+    }
+
+private:
+    std::vector<float> targetLevel { 0.0f, 0.0f };
+    std::vector<float> currentLevel { 0.0f, 0.0f };
+    juce::Colour glowColour { juce::Colour::fromRGB (0xff, 0x2f, 0xd0) };
+    juce::Colour fillColour { juce::Colour::fromRGB (0x27, 0xe8, 0xff) };
+    juce::Colour backColour { juce::Colour::fromRGB (0x10, 0x0d, 0x18) };
+};
@@ -0,0 +1,185 @@
+#include "MidiControl.h"
+#include "EngineSettings.h"
+
+//==============================================================================
+MidiControl::~MidiControl()
+{
+    close();
+}
+
+juce::String MidiControl::open (const juce::String& deviceName)
+{
+    close();
+
+    for (const auto& device : juce::MidiInput::getAvailableDevices())
+    {
+        if (device.name != deviceName && device.identifier != deviceName)
+            continue;
+
+        input = juce::MidiInput::openDevice (device.identifier, this);
+
+        if (input == nullptr)
+            return "Couldn't open MIDI input \"" + deviceName + "\"";
+
+        input->start();
+        return {};
+    }
+
+    return "MIDI input \"" + deviceName + "\" not found";
+}
+
+void MidiControl::close()
+{
+    if (input != nullptr)
+        input->stop();
+
+    input.reset();
+}
+
+//==============================================================================
+void MidiControl::setPlugin (const juce::String& identifier)
+{
+    if (identifier == pluginIdentifier)
+        return;
+
+    pluginIdentifier = identifier;
+    learnTarget = -1;
+
+    for (auto& m : mapping)
+        m.store (-1);
+
+    auto xml = EngineSettings::loadXml (settingsKey);
+
+    if (xml == nullptr || xml->getStringAttribute ("plugin") != pluginIdentifier)
+        return;
+
+    for (auto* child : xml->getChildWithTagNameIterator ("MAP"))
+    {
+        const int controller = child->getIntAttribute ("channel") * 128 + child->getIntAttribute ("controller");
+
+        if (juce::isPositiveAndBelow (controller, numControllers))
+            mapping[(size_t) controller].store (child->getIntAttribute ("parameter", -1));
+    }
+}
+
+int MidiControl::getNumMappings() const noexcept
+{
+    int count = 0;
+
+    for (auto& m : mapping)
+        count += m.load() >= 0 ? 1 : 0;
+
+    return count;
+}
+
+void MidiControl::learn (int parameterIndex)
+{
+    learnTarget = parameterIndex;
+    lastController.store (-1);
+}
+
+bool MidiControl::updateLearn()
+{
+    const int controller = lastController.exchange (-1);
+
+    if (learnTarget < 0 || controller < 0)
+        return false;
+
+    for (auto& m : mapping)
+        if (m.load() == learnTarget)
+            m.store (-1);
+
+    mapping[(size_t) controller].store (learnTarget);
+    learnTarget = -1;
+    save();
+    return true;
+}
+
+void MidiControl::save() const
+{
+    juce::XmlElement xml ("MIDIMAP");
+    xml.setAttribute ("plugin", pluginIdentifier);
+
+    for (int controller = 0; controller < numControllers; ++controller)
+    {
+        const int parameter = mapping[(size_t) controller].load();
+
+        if (parameter < 0)
+            continue;
+
+        auto* child = xml.createNewChildElement ("MAP");
+        child->setAttribute ("channel", controller / 128);
+        child->setAttribute ("controller", controller % 128);
+        child->setAttribute ("parameter", parameter);
+    }
+
+    EngineSettings::storeXml (settingsKey, xml);
+}
+
+//==============================================================================
+void MidiControl::handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message)
+{
+    // Short messages only; sysex has no business in a live controller path.
+    const int size = message.getRawDataSize();
+
+    if (size <= 0 || size > 3)
+        return;
+
+    Event event {};
+    std::memcpy (event.data, message.getRawData(), (size_t) size);
+    event.size = size;
+    event.timestamp = juce::Time::getHighResolutionTicks();
+
+    received.fetch_add (1, std::memory_order_relaxed);
+
+    if (! arrivals.push (event))
+        dropped.fetch_add (1, std::memory_order_relaxed);
+}
+
+void MidiControl::reset() noexcept
+{
+    arrivals.discardAll();
+    scheduled.discardAll();
+}
+
+void MidiControl::schedule (juce::int64 devicePosition, int numSamples, double sampleRate, ParameterScheduler& parameters) noexcept
+{
+    const auto now = juce::Time::getHighResolutionTicks();
+    const double samplesPerTick = sampleRate / (double) juce::Time::getHighResolutionTicksPerSecond();
+    Event event {};
+
+    while (arrivals.pop (event))
+    {
+        const auto receivedTicks = event.timestamp;
+        const auto ageInSamples = (juce::int64) ((double) (now - receivedTicks) * samplesPerTick);
+        event.timestamp = devicePosition + numSamples - ageInSamples;
+
+        if (event.size == 3 && (event.data[0] & 0xf0) == 0xb0)
+        {
+            const int controller = (event.data[0] & 0x0f) * 128 + event.data[1];
+            const int parameter = mapping[(size_t) controller].load (std::memory_order_relaxed);
+            lastController.store (controller);
+
+            if (parameter >= 0 && parameters.scheduleAt (parameter, (float) event.data[2] / 127.0f, event.timestamp, receivedTicks))
+                mapped.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        if (! scheduled.push (event))
+            dropped.fetch_add (1, std::memory_order_relaxed);
+    }
+}
+
+void MidiControl::collect (juce::int64 segmentPosition, int numSamples, juce::MidiBuffer& dest) noexcept
+{
+    dest.clear();
+
+    const auto segmentEnd = segmentPosition + numSamples;
+    Event event {};
+
+    while (scheduled.peek (event) && event.timestamp < segmentEnd)
+    {
+        const auto offset = juce::jlimit ((juce::int64) 0, (juce::int64) juce::jmax (0, numSamples - 1), event.timestamp - segmentPosition);
+        dest.addEvent (event.data, event.size, (int) offset);
+        scheduled.pop (event);
+    }
+}
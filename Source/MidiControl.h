@@ -0,0 +1,100 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeQueue.h"
+#include "ParameterScheduler.h"
+#include <array>
+#include <atomic>
+#include <memory>
+
+// Hardware MIDI into the render path.
+//
+// The MIDI input's thread only timestamps each message and queues it. At the top of each
+// device callback the queued messages get input sample positions the same way
+// ParameterScheduler places the UI's changes: one device period after they arrived. A
+// controller with a learned mapping becomes a parameter change at that position, so the
+// scheduler splits the block there. Every message also goes on to the render side, which
+// hands each sub-block the events inside it in a buffer allocated once up front.
+//
+// The controller-to-parameter table is a flat array of atomics. The device callback
+// looks mappings up without a lock while the message thread learns new ones.
+class MidiControl  : private juce::MidiInputCallback
+{
+public:
+    explicit MidiControl (const juce::String& key) : settingsKey (key)
+    {
+        for (auto& m : mapping)
+            m.store (-1);
+    }
+
+    ~MidiControl() override;
+
+    // Message thread. Opens the input with this name or identifier. Returns an error
+    // message on failure.
+    juce::String open (const juce::String& deviceName);
+    void close();
+    bool isOpen() const noexcept                { return input != nullptr; }
+    juce::String getDeviceName() const          { return input != nullptr ? input->getName() : juce::String(); }
+
+    // Message thread. Mappings are kept per plugin and saved with the settings.
+    void setPlugin (const juce::String& identifier);
+    int getNumMappings() const noexcept;
+
+    // Message thread. The next controller moved gets mapped to this parameter,
+    // replacing whatever it or the parameter was mapped to before.
+    void learn (int parameterIndex);
+    void cancelLearn()                          { learnTarget = -1; }
+    bool isLearning() const noexcept            { return learnTarget >= 0; }
+
+    // Message thread, frequently. Returns true when a learn has just completed.
+    bool updateLearn();
+
+    // While the audio callback is stopped.
+    void reset() noexcept;
+
+    // Device callback, before ParameterScheduler::schedule. devicePosition is the input
+    // sample index of the first sample in this callback.
+    void schedule (juce::int64 devicePosition, int numSamples, double sampleRate, ParameterScheduler& parameters) noexcept;
+
+    // Device callback, when nothing is rendered: throws away what has arrived.
+    void discardArrivals() noexcept             { arrivals.discardAll(); }
+
+    // Render thread. Replaces dest's contents with the events due before the end of the
+    // segment, at their offsets from its start. Late ones land on its first sample.
+    void collect (juce::int64 segmentPosition, int numSamples, juce::MidiBuffer& dest) noexcept;
+
+    // Any thread.
+    int getReceivedCount() const noexcept       { return received.load(); }
+    int getMappedCount() const noexcept         { return mapped.load(); }
+    int getDroppedCount() const noexcept        { return dropped.load(); }
+
+private:
+    struct Event
+    {
+        juce::uint8 data[3];
+        int size;
+        juce::int64 timestamp;  // high-resolution ticks when received, then input sample position once scheduled
+    };
+
+    static constexpr int numControllers = 16 * 128;   // channel * 128 + controller number
+
+    void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message) override;
+    void save() const;
+
+    const juce::String settingsKey;
+    std::unique_ptr<juce::MidiInput> input;
+    juce::String pluginIdentifier;
+
+    LockFreeQueue<Event> arrivals { 1024 };      // MIDI thread to device callback
+    LockFreeQueue<Event> scheduled { 1024 };     // device callback to render thread
+    std::array<std::atomic<int>, (size_t) numControllers> mapping;   // parameter index, or -1
+
+    std::atomic<int> lastController { -1 };     // latest controller moved, for learning
+    int learnTarget = -1;                       // message thread
+
+    std::atomic<int> received { 0 };
+    std::atomic<int> mapped { 0 };
+    std::atomic<int> dropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiControl)
+};
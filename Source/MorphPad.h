@@ -0,0 +1,94 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetBank.h"
+#include <array>
+#include <functional>
+
+// XY pad for preset morphing: the preset slots sit at the corners (A top-left, B
+// top-right, C bottom-left, D bottom-right) and dragging the puck reports a position
+// from 0 to 1 on each axis. Slots without a snapshot are drawn dimmed.
+class MorphPad : public juce::Component
+{
+public:
+    std::function<void (float, float)> onMove;
+
+    void setPosition (juce::Point<float> newPosition)
+    {
+        if (newPosition != position)
+        {
+            position = newPosition;
+            repaint();
+        }
+    }
+
+    void setAvailableSlots (const std::array<bool, (size_t) PresetBank::numSlots>& slots)
+    {
+        if (slots != available)
+        {
+            available = slots;
+            repaint();
+        }
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto area = getLocalBounds().toFloat().reduced (1.0f);
+        const auto glow = juce::Colour::fromRGB (0xff, 0x2f, 0xd0);
+        const auto trace = juce::Colour::fromRGB (0x27, 0xe8, 0xff);
+        const float alpha = isEnabled() ? 1.0f : 0.4f;
+
+        g.setColour (juce::Colour::fromRGB (0x10, 0x0d, 0x18).withAlpha (0.6f));
+        g.fillRoundedRectangle (area, 6.0f);
+        g.setColour (glow.withAlpha (0.5f * alpha));
+        g.drawRoundedRectangle (area, 6.0f, 1.8f);
+
+        auto inner = area.reduced (puckRadius);
+        g.setColour (juce::Colours::white.withAlpha (0.08f * alpha));
+        g.drawLine (inner.getCentreX(), inner.getY(), inner.getCentreX(), inner.getBottom(), 1.0f);
+        g.drawLine (inner.getX(), inner.getCentreY(), inner.getRight(), inner.getCentreY(), 1.0f);
+
+        g.setFont (12.0f);
+
+        for (int slot = 0; slot < PresetBank::numSlots; ++slot)
+        {
+            const auto corner = juce::Point<float> (slot % 2 == 0 ? inner.getX() : inner.getRight(),
+                                                    slot < 2 ? inner.getY() : inner.getBottom());
+            g.setColour (juce::Colours::white.withAlpha ((available[(size_t) slot] ? 0.85f : 0.25f) * alpha));
+            g.drawText (PresetBank::getSlotName (slot), juce::Rectangle<float> (16.0f, 14.0f).withCentre (corner),
+                        juce::Justification::centred, false);
+        }
+
+        const auto puck = toPixels (position, inner);
+        g.setColour (trace.withAlpha (0.25f * alpha));
+        g.fillEllipse (juce::Rectangle<float> (puckRadius * 3.0f, puckRadius * 3.0f).withCentre (puck));
+        g.setColour (trace.withAlpha (alpha));
+        g.fillEllipse (juce::Rectangle<float> (puckRadius * 1.4f, puckRadius * 1.4f).withCentre (puck));
+    }
+
+    void enablementChanged() override                      { repaint(); }
+    void mouseDown (const juce::MouseEvent& e) override   { moveTo (e.position); }
+    void mouseDrag (const juce::MouseEvent& e) override   { moveTo (e.position); }
+
+private:
+    static constexpr float puckRadius = 7.0f;
+
+    static juce::Point<float> toPixels (juce::Point<float> p, juce::Rectangle<float> inner)
+    {
+        return { inner.getX() + p.x * inner.getWidth(), inner.getY() + p.y * inner.getHeight() };
+    }
+
+    void moveTo (juce::Point<float> pixel)
+    {
+        const auto inner = getLocalBounds().toFloat().reduced (1.0f + puckRadius);
+
+        setPosition ({ juce::jlimit (0.0f, 1.0f, (pixel.x - inner.getX()) / juce::jmax (1.0f, inner.getWidth())),
+                       juce::jlimit (0.0f, 1.0f, (pixel.y - inner.getY()) / juce::jmax (1.0f, inner.getHeight())) });
+
+        if (onMove != nullptr)
+            onMove (position.x, position.y);
+    }
+
+    juce::Point<float> position;
+    std::array<bool, (size_t) PresetBank::numSlots> available {};
+};
@@ -0,0 +1,363 @@
+#include "NativeChainProcessor.h"
+
+namespace
+{
+    constexpr float butterworthQ = 0.70710678f;
+
+    float sumLanes (Float4 x) noexcept
+    {
+        float lanes[4];
+        x.store (lanes);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    juce::NormalisableRange<float> skewedRange (float start, float end, float centre)
+    {
+        juce::NormalisableRange<float> range (start, end);
+        range.setSkewForCentre (centre);
+        return range;
+    }
+}
+
+//==============================================================================
+NativeChainProcessor::NativeChainProcessor()
+    : juce::AudioPluginInstance (BusesProperties().withInput ("Input", juce::AudioChannelSet::stereo(), true)
+                                                  .withOutput ("Output", juce::AudioChannelSet::stereo(), true))
+{
+    // The order matters: StardustEditor hands each slot the first unclaimed parameter
+    // whose name matches, and it matches loosely ("Freq" contains "q").
+    addFloat ("bassRotator",    "Bass Phase Rotator",   { 0.0f, 1.0f }, 0.5f, {});
+    addFloat ("bassFreq",       "Bass Freq",            skewedRange (20.0f, 300.0f, 80.0f), 80.0f, "Hz");
+    addFloat ("bassQ",          "Bass Q",               skewedRange (0.3f, 4.0f, 1.0f), 0.8f, {});
+    addFloat ("bassGain",       "Bass Gain",            { -6.0f, 12.0f }, 3.0f, "dB");
+
+    addFloat ("trebleRotator",  "Treble Phase Rotator", { 0.0f, 1.0f }, 0.0f, {});
+    addFloat ("trebleFreq",     "Treble Freq",          skewedRange (1500.0f, 16000.0f, 6000.0f), 8000.0f, "Hz");
+    addFloat ("trebleQ",        "Treble Q",             skewedRange (0.3f, 4.0f, 1.0f), 0.8f, {});
+    addFloat ("trebleGain",     "Treble Gain",          { -6.0f, 12.0f }, 2.0f, "dB");
+
+    addFloat ("stereoWidth",    "Stereo Wide Coef",     { 0.0f, 2.0f }, 1.2f, {});
+    addFloat ("stereoDelay",    "Stereo Delay",         { 0.0f, maxStereoDelayMs }, 0.0f, "ms");
+
+    addFloat ("wbInput",        "Wideband Input Gain",  { -24.0f, 24.0f }, 0.0f, "dB");
+    addFloat ("wbThreshold",    "Wideband Threshold",   { -60.0f, 0.0f }, -18.0f, "dB");
+    addFloat ("wbRatio",        "Wideband Ratio",       skewedRange (1.0f, 20.0f, 4.0f), 3.0f, ":1");
+    addFloat ("wbAttack",       "Wideband Attack",      skewedRange (0.1f, 100.0f, 10.0f), 10.0f, "ms");
+    addFloat ("wbRelease",      "Wideband Release",     skewedRange (10.0f, 2000.0f, 200.0f), 200.0f, "ms");
+    addFloat ("wbOutput",       "Wideband Output Gain", { -24.0f, 24.0f }, 0.0f, "dB");
+
+    addFloat ("mbInput",        "MB Input Gain",        { -24.0f, 24.0f }, 0.0f, "dB");
+    addFloat ("mbThreshold",    "MB Threshold",         { -60.0f, 0.0f }, -24.0f, "dB");
+    addFloat ("mbRatio",        "MB Ratio",             skewedRange (1.0f, 20.0f, 4.0f), 2.0f, ":1");
+    addFloat ("mbAttack",       "MB Attack",            skewedRange (0.1f, 100.0f, 10.0f), 5.0f, "ms");
+    addFloat ("mbRelease",      "MB Release",           skewedRange (10.0f, 2000.0f, 200.0f), 150.0f, "ms");
+    addFloat ("mbOutput",       "MB Output Gain",       { -24.0f, 24.0f }, 0.0f, "dB");
+}
+
+void NativeChainProcessor::addFloat (const juce::String& id, const juce::String& name,
+                                      juce::NormalisableRange<float> range, float defaultValue,
+                                      const juce::String& label)
+{
+    auto param = std::make_unique<HostedFloatParameter> (id, name, range, defaultValue, label);
+    params.push_back (param.get());
+    addHostedParameter (std::move (param));
+}
+
+void NativeChainProcessor::fillInPluginDescription (juce::PluginDescription& description) const
+{
+    description.name = getName();
+    description.descriptiveName = "Enhancers, stereo width, wideband and multiband compression";
+    description.pluginFormatName = "Built-in";
+    description.category = "Effect";
+    description.manufacturerName = "starnails";
+    description.version = "1.0";
+    description.fileOrIdentifier = identifier;
+    description.uniqueId = 0x534e4331;   // 'SNC1'
+    description.isInstrument = false;
+    description.numInputChannels = 2;
+    description.numOutputChannels = 2;
+}
+
+bool NativeChainProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+    const auto main = layouts.getMainOutputChannelSet();
+
+    return layouts.inputBuses.size() == 1 && layouts.outputBuses.size() == 1
+        && layouts.getMainInputChannelSet() == main
+        && (main == juce::AudioChannelSet::stereo() || main == juce::AudioChannelSet::mono());
+}
+
+//==============================================================================
+NativeChainProcessor::Settings NativeChainProcessor::readSettings() const noexcept
+{
+    auto v = [this] (size_t i) { return params[i]->get(); };
+
+    return { v (0),  v (1),  v (2),  v (3),
+             v (4),  v (5),  v (6),  v (7),
+             v (8),  v (9),
+             v (10), v (11), v (12), v (13), v (14), v (15),
+             v (16), v (17), v (18), v (19), v (20), v (21) };
+}
+
+bool NativeChainProcessor::Settings::sameFilters (const Settings& other) const noexcept
+{
+    return bassRotator == other.bassRotator && bassFreq == other.bassFreq && bassQ == other.bassQ && bassGain == other.bassGain
+        && trebleRotator == other.trebleRotator && trebleFreq == other.trebleFreq && trebleQ == other.trebleQ && trebleGain == other.trebleGain;
+}
+
+float NativeChainProcessor::coefficientForMs (float ms) const noexcept
+{
+    return 1.0f - std::exp (-1.0f / (juce::jmax (0.01f, ms) * 0.001f * (float) rate));
+}
+
+void NativeChainProcessor::prepareToPlay (double sampleRate, int)
+{
+    rate = sampleRate;
+    setLatencySamples (1);
+
+    sideDelay.assign ((size_t) (maxStereoDelayMs * 0.001 * sampleRate) + 2, 0.0f);
+
+    // Crossovers only move with the sample rate.
+    for (int i = 0; i < 3; ++i)
+    {
+        const auto low = Biquad4::design (Biquad4::Shape::lowPass, rate, crossovers[i], butterworthQ);
+        const auto high = Biquad4::design (Biquad4::Shape::highPass, rate, crossovers[i], butterworthQ);
+
+        for (auto& stage : split[i])
+        {
+            stage.setLane (0, low);
+            stage.setLane (1, low);
+            stage.setLane (2, high);
+            stage.setLane (3, high);
+        }
+    }
+
+    const auto allPass2 = Biquad4::design (Biquad4::Shape::allPass, rate, crossovers[1], butterworthQ);
+    const auto allPass3 = Biquad4::design (Biquad4::Shape::allPass, rate, crossovers[2], butterworthQ);
+    align[0].setLane (0, allPass2);
+    align[0].setLane (1, allPass2);
+    align[0].setLane (2, allPass3);
+    align[0].setLane (3, allPass3);
+    align[1].setLane (0, allPass3);
+    align[1].setLane (1, allPass3);
+
+    current = readSettings();
+    updateFilters (current);
+    updateBlockSettings (current, 1);
+    reset();
+}
+
+void NativeChainProcessor::reset()
+{
+    rotator.reset();
+    enhancer.reset();
+    bassOut[0] = bassOut[1] = 0.0f;
+
+    std::fill (sideDelay.begin(), sideDelay.end(), 0.0f);
+    sideWrite = 0;
+
+    for (auto& pair : split)
+        for (auto& stage : pair)
+            stage.reset();
+
+    for (auto& stage : align)
+        stage.reset();
+
+    wbEnvelope = 0.0f;
+    wbGain = wbMakeup;
+    wbGainStep = 0.0f;
+    mbEnvelope = Float4();
+    mbGain = Float4 (mbMakeup);
+    mbGainStep = Float4();
+    chunkPosition = 0;
+}
+
+void NativeChainProcessor::updateFilters (const Settings& s) noexcept
+{
+    const auto bassPeak = Biquad4::design (Biquad4::Shape::peak, rate, s.bassFreq, s.bassQ, s.bassGain);
+    const auto treblePeak = Biquad4::design (Biquad4::Shape::peak, rate, s.trebleFreq, s.trebleQ, s.trebleGain);
+
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        // The rotator parameters run from 0 to 180 degrees.
+        rotator.setAngle (lane, (lane < 2 ? s.bassRotator : s.trebleRotator) * juce::MathConstants<float>::pi);
+        enhancer.setLane (lane, lane < 2 ? bassPeak : treblePeak);
+    }
+
+    filtersValid = true;
+}
+
+// Block rate. Width and input gains that change between blocks are ramped across the block.
+void NativeChainProcessor::updateBlockSettings (const Settings& s, int numSamples) noexcept
+{
+    const float invSamples = 1.0f / (float) juce::jmax (1, numSamples);
+
+    widthStart = current.stereoWidth;
+    widthStep = (s.stereoWidth - current.stereoWidth) * invSamples;
+    delaySamples = juce::jlimit (0, (int) sideDelay.size() - 1, juce::roundToInt (s.stereoDelayMs * 0.001 * rate));
+
+    wbInputStart = juce::Decibels::decibelsToGain (current.wbInputDb);
+    wbInputStep = (juce::Decibels::decibelsToGain (s.wbInputDb) - wbInputStart) * invSamples;
+    wbAttack = coefficientForMs (s.wbAttackMs);
+    wbRelease = coefficientForMs (s.wbReleaseMs);
+    wbThreshold = juce::Decibels::decibelsToGain (s.wbThresholdDb);
+    wbSlope = 1.0f / juce::jmax (1.0f, s.wbRatio) - 1.0f;
+    wbMakeup = juce::Decibels::decibelsToGain (s.wbOutputDb);
+
+    mbInputStart = juce::Decibels::decibelsToGain (current.mbInputDb);
+    mbInputStep = (juce::Decibels::decibelsToGain (s.mbInputDb) - mbInputStart) * invSamples;
+    mbAttack = Float4 (coefficientForMs (s.mbAttackMs));
+    mbRelease = Float4 (coefficientForMs (s.mbReleaseMs));
+    mbThreshold = juce::Decibels::decibelsToGain (s.mbThresholdDb);
+    mbSlope = 1.0f / juce::jmax (1.0f, s.mbRatio) - 1.0f;
+    mbMakeup = juce::Decibels::decibelsToGain (s.mbOutputDb);
+}
+
+// Once per gain chunk: the gain each compressor should reach by the end of the next one.
+void NativeChainProcessor::updateWidebandGain() noexcept
+{
+    const float target = (wbEnvelope > wbThreshold ? std::pow (wbEnvelope / wbThreshold, wbSlope) : 1.0f) * wbMakeup;
+    wbGainStep = (target - wbGain) / (float) gainChunk;
+}
+
+void NativeChainProcessor::updateMultibandGains() noexcept
+{
+    float envelope[4], target[4];
+    mbEnvelope.store (envelope);
+
+    for (int band = 0; band < 4; ++band)
+        target[band] = (envelope[band] > mbThreshold ? std::pow (envelope[band] / mbThreshold, mbSlope) : 1.0f) * mbMakeup;
+
+    mbGainStep = (Float4::load (target) - mbGain) * Float4 (1.0f / (float) gainChunk);
+}
+
+//==============================================================================
+void NativeChainProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    const int numSamples = buffer.getNumSamples();
+
+    if (buffer.getNumChannels() == 0 || numSamples == 0 || sideDelay.empty())
+        return;
+
+    const auto s = readSettings();
+
+    if (! filtersValid || ! s.sameFilters (current))
+        updateFilters (s);
+
+    updateBlockSettings (s, numSamples);
+    current = s;
+
+    float* left = buffer.getWritePointer (0);
+    float* right = buffer.getNumChannels() > 1 ? buffer.getWritePointer (1) : nullptr;
+    const int delaySize = (int) sideDelay.size();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float l = left[i];
+        float r = right != nullptr ? right[i] : l;
+
+        // Enhancers: phase rotation, then the peak. Treble takes the bass stage's output
+        // from the previous sample.
+        {
+            const Float4 x (l, r, bassOut[0], bassOut[1]);
+            const Float4 rotated = rotator.process (x);
+
+            float lanes[4];
+            enhancer.process (rotated).store (lanes);
+            bassOut[0] = lanes[0];
+            bassOut[1] = lanes[1];
+            l = lanes[2];
+            r = lanes[3];
+        }
+
+        // Stereo enhancer: scaled, optionally delayed side.
+        {
+            const float mid = 0.5f * (l + r);
+            sideDelay[(size_t) sideWrite] = 0.5f * (l - r);
+
+            int readIndex = sideWrite - delaySamples;
+            readIndex += readIndex < 0 ? delaySize : 0;
+            const float side = sideDelay[(size_t) readIndex] * (widthStart + widthStep * (float) i);
+
+            sideWrite = sideWrite + 1 < delaySize ? sideWrite + 1 : 0;
+            l = mid + side;
+            r = mid - side;
+        }
+
+        // Wideband compressor.
+        {
+            const float inputGain = wbInputStart + wbInputStep * (float) i;
+            l *= inputGain;
+            r *= inputGain;
+
+            const float level = juce::jmax (std::abs (l), std::abs (r));
+            wbEnvelope += (level > wbEnvelope ? wbAttack : wbRelease) * (level - wbEnvelope);
+
+            l *= wbGain;
+            r *= wbGain;
+            wbGain += wbGainStep;
+        }
+
+        // Multiband compressor.
+        {
+            const float inputGain = mbInputStart + mbInputStep * (float) i;
+            l *= inputGain;
+            r *= inputGain;
+
+            float first[4], second[4], third[4], aligned[4], low[4];
+
+            split[0][1].process (split[0][0].process (Float4 (l, r, l, r))).store (first);
+            split[1][1].process (split[1][0].process (Float4 (first[2], first[3], first[2], first[3]))).store (second);
+            split[2][1].process (split[2][0].process (Float4 (second[2], second[3], second[2], second[3]))).store (third);
+            align[0].process (Float4 (first[0], first[1], second[0], second[1])).store (aligned);
+            align[1].process (Float4 (aligned[0], aligned[1], 0.0f, 0.0f)).store (low);
+
+            const Float4 bandsL (low[0], aligned[2], third[0], third[2]);
+            const Float4 bandsR (low[1], aligned[3], third[1], third[3]);
+
+            const Float4 level = Float4::max (Float4::abs (bandsL), Float4::abs (bandsR));
+            mbEnvelope += Float4::selectGreater (level, mbEnvelope, mbAttack, mbRelease) * (level - mbEnvelope);
+
+            l = sumLanes (bandsL * mbGain);
+            r = sumLanes (bandsR * mbGain);
+            mbGain += mbGainStep;
+        }
+
+        if (++chunkPosition == gainChunk)
+        {
+            chunkPosition = 0;
+            updateWidebandGain();
+            updateMultibandGains();
+        }
+
+        left[i] = l;
+
+        if (right != nullptr)
+            right[i] = r;
+    }
+}
+
+//==============================================================================
+void NativeChainProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    juce::XmlElement xml ("NATIVECHAIN");
+
+    for (auto* param : params)
+        xml.setAttribute (param->getParameterID(), param->get());
+
+    copyXmlToBinary (xml, destData);
+}
+
+void NativeChainProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    auto xml = getXmlFromBinary (data, sizeInBytes);
+
+    if (xml == nullptr || ! xml->hasTagName ("NATIVECHAIN"))
+        return;
+
+    for (auto* param : params)
+        if (xml->hasAttribute (param->getParameterID()))
+            param->setValueNotifyingHost (param->convertTo0to1 ((float) xml->getDoubleAttribute (param->getParameterID())));
+}
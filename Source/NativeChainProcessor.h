@@ -0,0 +1,113 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SimdFloat4.h"
+#include "HostedParameters.h"
+#include <vector>
+
+// A built-in stand-in for Stardust: bass and treble enhancers, a stereo enhancer, a
+// wideband compressor and a three-crossover multiband compressor, in that order, running
+// in-process with no plugin file to find and no bridge to go through. Its parameters are
+// named and ordered so StardustEditor sorts them into the same five groups.
+//
+// It presents itself as a plugin instance so the pipeline can host it exactly like a
+// loaded one: hot swaps, presets, bypass and the watchdog all work unchanged.
+//
+// The kernels run four lanes at a time through Float4. The two enhancers share one pass
+// with bass in lanes 0-1 and treble in lanes 2-3; treble works on the bass output from
+// the sample before, which is the one sample of latency the processor reports. The
+// crossovers filter left and right low and high sides together, and the multiband
+// detectors and gains run one band per lane.
+class NativeChainProcessor  : public juce::AudioPluginInstance
+{
+public:
+    NativeChainProcessor();
+
+    static constexpr const char* identifier = "builtin:StardustNative";
+
+    //==============================================================================
+    const juce::String getName() const override                 { return "Stardust Native"; }
+    void fillInPluginDescription (juce::PluginDescription& description) const override;
+
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override {}
+    void reset() override;
+    void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) override;
+
+    double getTailLengthSeconds() const override                { return 0.0; }
+    bool acceptsMidi() const override                           { return false; }
+    bool producesMidi() const override                          { return false; }
+    juce::AudioProcessorEditor* createEditor() override         { return nullptr; }
+    bool hasEditor() const override                             { return false; }
+
+    int getNumPrograms() override                               { return 1; }
+    int getCurrentProgram() override                            { return 0; }
+    void setCurrentProgram (int) override {}
+    const juce::String getProgramName (int) override            { return {}; }
+    void changeProgramName (int, const juce::String&) override {}
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+private:
+    // Parameter values as of the start of a block, in plain units.
+    struct Settings
+    {
+        float bassRotator, bassFreq, bassQ, bassGain;
+        float trebleRotator, trebleFreq, trebleQ, trebleGain;
+        float stereoWidth, stereoDelayMs;
+        float wbInputDb, wbThresholdDb, wbRatio, wbAttackMs, wbReleaseMs, wbOutputDb;
+        float mbInputDb, mbThresholdDb, mbRatio, mbAttackMs, mbReleaseMs, mbOutputDb;
+
+        bool sameFilters (const Settings& other) const noexcept;
+    };
+
+    Settings readSettings() const noexcept;
+    void updateFilters (const Settings& s) noexcept;
+    void updateBlockSettings (const Settings& s, int numSamples) noexcept;
+    void updateWidebandGain() noexcept;
+    void updateMultibandGains() noexcept;
+    float coefficientForMs (float ms) const noexcept;
+
+    void addFloat (const juce::String& id, const juce::String& name,
+                   juce::NormalisableRange<float> range, float defaultValue, const juce::String& label);
+
+    static constexpr float crossovers[3] = { 150.0f, 1200.0f, 6000.0f };
+    static constexpr int gainChunk = 16;        // samples between compressor gain updates
+    static constexpr float maxStereoDelayMs = 20.0f;
+
+    std::vector<HostedFloatParameter*> params;
+    double rate = 44100.0;
+    Settings current {};
+    bool filtersValid = false;
+
+    // Enhancers: lanes are bass L, bass R, treble L, treble R.
+    PhaseRotator4 rotator;
+    Biquad4 enhancer;
+    float bassOut[2] {};
+
+    // Stereo enhancer: side signal delay line.
+    std::vector<float> sideDelay;
+    int sideWrite = 0;
+    float widthStart = 1.0f, widthStep = 0.0f;
+    int delaySamples = 0;
+
+    // Wideband compressor, stereo-linked.
+    float wbEnvelope = 0.0f, wbGain = 1.0f, wbGainStep = 0.0f;
+    float wbAttack = 0.0f, wbRelease = 0.0f, wbThreshold = 1.0f, wbSlope = 0.0f, wbMakeup = 1.0f;
+    float wbInputStart = 1.0f, wbInputStep = 0.0f;
+
+    // Multiband: each split is a Linkwitz-Riley pair, low side in lanes 0-1 and high side
+    // in lanes 2-3. The lower bands then go through the allpasses of the crossovers above
+    // them so the bands sum flat: low through the second and third, low-mid the third.
+    Biquad4 split[3][2];
+    Biquad4 align[2];
+    Float4 mbEnvelope, mbGain { 1.0f }, mbGainStep;
+    Float4 mbAttack, mbRelease;
+    float mbThreshold = 1.0f, mbSlope = 0.0f, mbMakeup = 1.0f;
+    float mbInputStart = 1.0f, mbInputStep = 0.0f;
+    int chunkPosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NativeChainProcessor)
+};
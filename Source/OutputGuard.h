@@ -0,0 +1,140 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define STARNAILS_GUARD_SSE2 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+ #include <arm_neon.h>
+ #define STARNAILS_GUARD_NEON 1
+#endif
+
+// Checks every block coming out of the plugin for values that must never reach the
+// device. A channel holding NaN or Inf is muted for that block; denormals are flushed
+// to zero in place. The scan only looks at exponent bits, four samples at a time, so it
+// costs about as much as a copy. Counters may be read from any thread.
+class OutputGuard
+{
+public:
+    struct Scan
+    {
+        bool nonFinite = false;
+        bool denormal = false;
+    };
+
+    void resetCounters() noexcept
+    {
+        nonFiniteBlocks.store (0);
+        denormalBlocks.store (0);
+    }
+
+    int getNonFiniteCount() const noexcept    { return nonFiniteBlocks.load(); }
+    int getDenormalCount() const noexcept     { return denormalBlocks.load(); }
+
+    // Render thread or pool worker; several may run it on different buffers at once.
+    void process (juce::AudioBuffer<float>& buffer) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+        bool anyNonFinite = false, anyDenormal = false;
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* data = buffer.getWritePointer (ch);
+            const auto result = scan (data, numSamples);
+
+            if (result.nonFinite)
+            {
+                buffer.clear (ch, 0, numSamples);
+                anyNonFinite = true;
+            }
+            else if (result.denormal)
+            {
+                flushDenormals (data, numSamples);
+                anyDenormal = true;
+            }
+        }
+
+        if (anyNonFinite)  nonFiniteBlocks.fetch_add (1, std::memory_order_relaxed);
+        if (anyDenormal)   denormalBlocks.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    static Scan scan (const float* data, int numSamples) noexcept
+    {
+        constexpr juce::uint32 expMask = 0x7f800000u;
+        constexpr juce::uint32 absMask = 0x7fffffffu;
+
+        Scan result;
+        int i = 0;
+
+       #if STARNAILS_GUARD_SSE2
+        const __m128i expMask4 = _mm_set1_epi32 ((int) expMask);
+        const __m128i absMask4 = _mm_set1_epi32 ((int) absMask);
+        const __m128i zero4 = _mm_setzero_si128();
+        __m128i nonFinite4 = zero4, denormal4 = zero4;
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128i bits = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (data + i));
+            const __m128i exponent = _mm_and_si128 (bits, expMask4);
+            const __m128i magnitudeIsZero = _mm_cmpeq_epi32 (_mm_and_si128 (bits, absMask4), zero4);
+
+            nonFinite4 = _mm_or_si128 (nonFinite4, _mm_cmpeq_epi32 (exponent, expMask4));
+            denormal4 = _mm_or_si128 (denormal4, _mm_andnot_si128 (magnitudeIsZero, _mm_cmpeq_epi32 (exponent, zero4)));
+        }
+
+        result.nonFinite = _mm_movemask_epi8 (nonFinite4) != 0;
+        result.denormal = _mm_movemask_epi8 (denormal4) != 0;
+       #elif STARNAILS_GUARD_NEON
+        const uint32x4_t expMask4 = vdupq_n_u32 (expMask);
+        const uint32x4_t absMask4 = vdupq_n_u32 (absMask);
+        const uint32x4_t zero4 = vdupq_n_u32 (0);
+        uint32x4_t nonFinite4 = zero4, denormal4 = zero4;
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const uint32x4_t bits = vreinterpretq_u32_f32 (vld1q_f32 (data + i));
+            const uint32x4_t exponent = vandq_u32 (bits, expMask4);
+            const uint32x4_t magnitudeIsZero = vceqq_u32 (vandq_u32 (bits, absMask4), zero4);
+
+            nonFinite4 = vorrq_u32 (nonFinite4, vceqq_u32 (exponent, expMask4));
+            denormal4 = vorrq_u32 (denormal4, vbicq_u32 (vceqq_u32 (exponent, zero4), magnitudeIsZero));
+        }
+
+        auto anyLane = [] (uint32x4_t v)
+        {
+            return (vgetq_lane_u32 (v, 0) | vgetq_lane_u32 (v, 1) | vgetq_lane_u32 (v, 2) | vgetq_lane_u32 (v, 3)) != 0;
+        };
+
+        result.nonFinite = anyLane (nonFinite4);
+        result.denormal = anyLane (denormal4);
+       #endif
+
+        for (; i < numSamples; ++i)
+        {
+            juce::uint32 bits;
+            std::memcpy (&bits, data + i, sizeof (bits));
+            const auto exponent = bits & expMask;
+
+            result.nonFinite |= exponent == expMask;
+            result.denormal |= exponent == 0 && (bits & absMask) != 0;
+        }
+
+        return result;
+    }
+
+private:
+    static void flushDenormals (float* data, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            if (std::abs (data[i]) < std::numeric_limits<float>::min())
+                data[i] = 0.0f;
+    }
+
+    std::atomic<int> nonFiniteBlocks { 0 };
+    std::atomic<int> denormalBlocks { 0 };
+};
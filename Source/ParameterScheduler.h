@@ -0,0 +1,285 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeQueue.h"
+#include <array>
+#include <atomic>
+
+// Gives UI parameter changes deterministic timing inside the audio stream.
+//
+// The message thread posts changes with a timestamp. At the top of each device callback
+// they are converted to absolute input sample positions exactly one device period after
+// they happened, so automation latency is constant instead of depending on where in the
+// buffer the message thread happened to run. The render side then splits each block at
+// those positions (never into pieces shorter than the minimum sub-block size) and
+// applies every change right before the segment it belongs to.
+//
+// Applied changes are queued back to the message thread, which tells the parameter's
+// listeners afterwards; nothing but the plugin's own setValue runs on the audio side.
+// Each change also records how long it took from the slider to the plugin.
+//
+// A touch drag posts far more values than the audio side can use, and many plugins
+// recompute coefficients on every one. So each callback's batch keeps only the last
+// value per parameter and counts the rest as coalesced. Gesture begin/end travel the
+// same queues, so listeners always hear them around the values they bracket. Changes
+// that arrive with a position of their own (MIDI controllers) join the same batch.
+//
+// The queues to the render side and back keep some room that only gestures may use, so
+// a flood of values can never swallow an endChangeGesture. Values that find no room are
+// dropped and counted.
+class ParameterScheduler
+{
+public:
+    enum class Kind : juce::uint8 { value, beginGesture, endGesture };
+
+    struct Change
+    {
+        Kind kind;
+        int parameterIndex;
+        float value;
+        juce::int64 timestamp;  // high-resolution ticks when posted, then input sample position once scheduled
+        juce::int64 postedTicks;
+    };
+
+    struct Latency
+    {
+        int numChanges = 0;
+        double averageMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+    void setMinimumSubBlock (int numSamples) noexcept   { minSubBlock = juce::jmax (1, numSamples); }
+
+    // Message thread. Returns false if the queue is full, which for values means the
+    // room kept for gestures is all that's left.
+    bool post (int parameterIndex, float value) noexcept
+    {
+        if (incoming.getFreeSpace() <= gestureReserve)
+            return false;
+
+        const auto now = juce::Time::getHighResolutionTicks();
+        return incoming.push ({ Kind::value, parameterIndex, value, now, now });
+    }
+
+    // Message thread. Returns false if the queue is full.
+    bool postGesture (int parameterIndex, bool starting) noexcept
+    {
+        const auto now = juce::Time::getHighResolutionTicks();
+        return incoming.push ({ starting ? Kind::beginGesture : Kind::endGesture, parameterIndex, 0.0f, now, now });
+    }
+
+    // Message thread. Calls notify (change) for each change and gesture applied since
+    // the last call, in order.
+    template <typename NotifyFn>
+    void dispatchApplied (NotifyFn&& notify)
+    {
+        Change change {};
+
+        while (applied.pop (change))
+            notify (change);
+    }
+
+    // Values that were replaced by a later one for the same parameter before reaching
+    // the plugin.
+    int getCoalescedCount() const noexcept      { return coalesced.load(); }
+
+    // Values that never reached the plugin because the render side was too far behind.
+    int getDroppedCount() const noexcept        { return dropped.load(); }
+
+    // Message thread. Post-to-apply latency of the changes applied since the last call.
+    Latency takeLatency() noexcept
+    {
+        Latency latency;
+        latency.numChanges = appliedCount.exchange (0);
+
+        const double msPerTick = 1000.0 / (double) juce::Time::getHighResolutionTicksPerSecond();
+        const auto totalTicks = appliedTicks.exchange (0);
+        const auto maxTicks = appliedMaxTicks.exchange (0);
+
+        if (latency.numChanges > 0)
+        {
+            latency.averageMs = (double) totalTicks * msPerTick / latency.numChanges;
+            latency.maxMs = (double) maxTicks * msPerTick;
+        }
+
+        return latency;
+    }
+
+    // Only while the audio callback is stopped.
+    void reset() noexcept
+    {
+        scheduled.discardAll();
+        batchSize = 0;
+    }
+
+    // Device callback, before anything is rendered. devicePosition is the input sample
+    // index of the first sample in this callback.
+    void schedule (juce::int64 devicePosition, int numSamples, double sampleRate) noexcept
+    {
+        const auto now = juce::Time::getHighResolutionTicks();
+        const double samplesPerTick = sampleRate / (double) juce::Time::getHighResolutionTicksPerSecond();
+
+        Change change {};
+
+        while (batchSize < maxBatch && incoming.pop (change))
+        {
+            const auto ageInSamples = (juce::int64) ((double) (now - change.timestamp) * samplesPerTick);
+            change.timestamp = devicePosition + numSamples - ageInSamples;
+            batch[(size_t) batchSize++] = change;
+        }
+
+        // Changes from scheduleAt and from the UI interleave in time.
+        sortBatch();
+
+        for (int i = 0; i < batchSize; ++i)
+            if (batch[(size_t) i].kind == Kind::value && batch[(size_t) i].parameterIndex >= 0)
+                supersedeEarlierValue (i, batch[(size_t) i].parameterIndex);
+
+        for (int i = 0; i < batchSize; ++i)
+            if (batch[(size_t) i].parameterIndex >= 0)
+                pushKeepingGestureRoom (scheduled, batch[(size_t) i]);
+
+        batchSize = 0;
+    }
+
+    // Device callback, before schedule(). Adds a value change that already has its input
+    // sample position, e.g. from a MIDI controller. It goes through the same coalescing
+    // and sub-block splitting as the UI's changes.
+    bool scheduleAt (int parameterIndex, float value, juce::int64 position, juce::int64 postedTicks) noexcept
+    {
+        if (batchSize >= maxBatch)
+            return false;
+
+        batch[(size_t) batchSize++] = { Kind::value, parameterIndex, value, position, postedTicks };
+        return true;
+    }
+
+    // Render thread. blockPosition is the input sample index of the buffer's first
+    // sample. apply (index, value) is called for each due change, render (segment) for
+    // each sub-block, in order.
+    template <typename ApplyFn, typename RenderFn>
+    void process (juce::AudioBuffer<float>& buffer, juce::int64 blockPosition, ApplyFn&& apply, RenderFn&& render)
+    {
+        const int numSamples = buffer.getNumSamples();
+        int segmentStart = 0;
+
+        while (segmentStart < numSamples)
+        {
+            // Anything due before the earliest point we could split again goes in now.
+            const auto applyBefore = blockPosition + segmentStart + minSubBlock;
+            Change change {};
+
+            while (scheduled.peek (change) && change.timestamp < applyBefore)
+            {
+                if (change.kind == Kind::value)
+                    apply (change.parameterIndex, change.value);
+
+                noteApplied (change);
+                scheduled.pop (change);
+            }
+
+            int segmentEnd = numSamples;
+
+            if (scheduled.peek (change) && change.timestamp < blockPosition + numSamples)
+                segmentEnd = (int) (change.timestamp - blockPosition);
+
+            // Don't leave a runt at the end of the block; those changes wait for the next one.
+            if (numSamples - segmentEnd < minSubBlock)
+                segmentEnd = numSamples;
+
+            juce::AudioBuffer<float> segment (buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                              segmentStart, segmentEnd - segmentStart);
+            render (segment);
+            segmentStart = segmentEnd;
+        }
+    }
+
+private:
+    // Stable insertion sort by position: the batch is small and nearly in order already,
+    // and std::stable_sort may allocate.
+    void sortBatch() noexcept
+    {
+        for (int i = 1; i < batchSize; ++i)
+        {
+            const auto change = batch[(size_t) i];
+            int j = i;
+
+            for (; j > 0 && batch[(size_t) j - 1].timestamp > change.timestamp; --j)
+                batch[(size_t) j] = batch[(size_t) j - 1];
+
+            batch[(size_t) j] = change;
+        }
+    }
+
+    // Drops the batch's previous value for this parameter, unless a gesture boundary
+    // lies between the two.
+    void supersedeEarlierValue (int position, int parameterIndex) noexcept
+    {
+        for (int i = position; --i >= 0;)
+        {
+            auto& earlier = batch[(size_t) i];
+
+            if (earlier.parameterIndex != parameterIndex)
+                continue;
+
+            if (earlier.kind == Kind::value)
+            {
+                earlier.parameterIndex = -1;
+                coalesced.fetch_add (1, std::memory_order_relaxed);
+            }
+
+            return;
+        }
+    }
+
+    // Gestures may use the whole queue, values all but the reserve. A value that doesn't
+    // fit is dropped; a gesture only could be if there were more than the reserve in flight.
+    bool pushKeepingGestureRoom (LockFreeQueue<Change>& queue, const Change& change) noexcept
+    {
+        const int needed = change.kind == Kind::value ? gestureReserve + 1 : 1;
+
+        if (queue.getFreeSpace() >= needed && queue.push (change))
+            return true;
+
+        jassert (change.kind == Kind::value);
+        dropped.fetch_add (1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void noteApplied (const Change& change) noexcept
+    {
+        // Gestures are only passed on to the listeners.
+        if (change.kind != Kind::value)
+        {
+            applied.push (change);
+            return;
+        }
+
+        const auto ticks = juce::Time::getHighResolutionTicks() - change.postedTicks;
+
+        appliedCount.fetch_add (1, std::memory_order_relaxed);
+        appliedTicks.fetch_add (ticks, std::memory_order_relaxed);
+
+        if (ticks > appliedMaxTicks.load (std::memory_order_relaxed))
+            appliedMaxTicks.store (ticks, std::memory_order_relaxed);
+
+        // If the message thread has fallen this far behind, listeners miss an update;
+        // the value itself has been set either way, so it isn't counted as dropped.
+        if (applied.getFreeSpace() > gestureReserve)
+            applied.push (change);
+    }
+
+    LockFreeQueue<Change> incoming { 1024 };
+    LockFreeQueue<Change> scheduled { 1024 };
+    LockFreeQueue<Change> applied { 1024 };
+    static constexpr int maxBatch = 1024;
+    static constexpr int gestureReserve = 64;
+    std::array<Change, maxBatch> batch {};     // device callback only
+    int batchSize = 0;                          // device callback only
+    std::atomic<int> coalesced { 0 };
+    std::atomic<int> dropped { 0 };
+    std::atomic<int> appliedCount { 0 };
+    std::atomic<juce::int64> appliedTicks { 0 };
+    std::atomic<juce::int64> appliedMaxTicks { 0 };
+    int minSubBlock = 32;
+};
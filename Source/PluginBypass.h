@@ -0,0 +1,204 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryResidency.h"
+#include <atomic>
+#include <cmath>
+
+// Click-free bypass around a plugin that keeps the plugin running the whole time.
+//
+// The bypassed signal is the input delayed by the plugin's reported latency, so
+// engaging bypass never shifts the timeline. Toggling crossfades between the plugin
+// output and that delayed dry signal with an equal-power curve. Once fully bypassed,
+// a plugin with native bypass (getBypassParameter, i.e. VST2 effSetBypass or VST3 soft
+// bypass) is switched into it and its own output is used; anything else keeps
+// processing into a scratch buffer so its state and tails stay current and coming back
+// costs nothing extra.
+//
+// A protective bypass (the CPU watchdog's) is the exception: once the fade is done the
+// plugin isn't called at all, since the point is to stop paying for it.
+//
+// Only the buffer it is given gets a dry signal. Anything else the plugin writes, such as
+// aux outputs, has to be faded by the caller using getPluginGainStart/End().
+class PluginBypass
+{
+public:
+    // Message thread, while the audio callback is stopped.
+    void prepare (int numChannels, int maxBlockSize, int fadeSamples)
+    {
+        blockCapacity = juce::jmax (1, maxBlockSize);
+        fadeLength = juce::jmax (1, fadeSamples);
+
+        delayLine.setSize (numChannels, maxLatency + blockCapacity, false, true, false);
+        delayLine.clear();
+        dry.setSize (numChannels, blockCapacity, false, true, false);
+        scratch.setSize (numChannels, blockCapacity, false, true, false);
+        writePosition = 0;
+
+        for (auto* buffer : { &delayLine, &dry, &scratch })
+            MemoryResidency::prefault (*buffer);
+
+        // Resume in whatever state we were in, without a fade.
+        amount = bypassed ? 1.0f : 0.0f;
+    }
+
+    bool isUsingNativeBypass() const noexcept     { return nativeEngaged.load(); }
+
+    // Render thread, after process(). How much of the plugin's own output that block
+    // carried at its start and end: 1 when active, 0 when fully bypassed.
+    float getPluginGainStart() const noexcept     { return pluginGainStart; }
+    float getPluginGainEnd() const noexcept       { return pluginGainEnd; }
+    int getCompensationSamples() const noexcept   { return compensation.load(); }
+
+    // Render thread. renderPlugin (buffer) runs the plugin in place on whatever it is
+    // given; plugin is the instance it currently goes to. While protective, a fully
+    // bypassed plugin is left idle instead of kept running.
+    template <typename RenderFn>
+    void process (juce::AudioBuffer<float>& buffer, juce::AudioPluginInstance& plugin,
+                  bool shouldBypass, bool protective, RenderFn&& renderPlugin) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+        const int numChannels = juce::jmin (buffer.getNumChannels(), dry.getNumChannels());
+        auto* nativeBypass = plugin.getBypassParameter();
+
+        bypassed = shouldBypass;
+        pluginGainStart = pluginGainEnd = 1.0f;
+
+        if (numSamples > blockCapacity)
+        {
+            // More than we prepared for; play it safe and just run the plugin.
+            setNative (nativeBypass, false);
+            renderPlugin (buffer);
+            return;
+        }
+
+        const int latency = juce::jlimit (0, maxLatency, plugin.getLatencySamples());
+        compensation.store (latency);
+        pushDry (buffer, numChannels, numSamples, latency);
+
+        const float target = shouldBypass ? 1.0f : 0.0f;
+
+        if (amount == target && ! shouldBypass)
+        {
+            setNative (nativeBypass, false);
+            renderPlugin (buffer);
+            return;
+        }
+
+        if (amount == target)
+            pluginGainStart = pluginGainEnd = 0.0f;
+
+        if (amount == target && protective)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                buffer.copyFrom (ch, 0, dry, ch, 0, numSamples);
+
+            return;
+        }
+
+        if (amount == target)
+        {
+            if (nativeBypass != nullptr)
+            {
+                setNative (nativeBypass, true);
+                renderPlugin (buffer);
+                return;
+            }
+
+            juce::AudioBuffer<float> warm (scratch.getArrayOfWritePointers(), numChannels, numSamples);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                warm.copyFrom (ch, 0, buffer, ch, 0, numSamples);
+
+            renderPlugin (warm);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                buffer.copyFrom (ch, 0, dry, ch, 0, numSamples);
+
+            return;
+        }
+
+        // Fading: the plugin has to be producing its processed output for the mix.
+        setNative (nativeBypass, false);
+        renderPlugin (buffer);
+
+        const float step = (target > amount ? 1.0f : -1.0f) / (float) fadeLength;
+        const float startAmount = amount;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* out = buffer.getWritePointer (ch);
+            const auto* dryIn = dry.getReadPointer (ch);
+            float a = startAmount;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                a = juce::jlimit (0.0f, 1.0f, a + step);
+                const float angle = a * juce::MathConstants<float>::halfPi;
+                out[i] = out[i] * std::cos (angle) + dryIn[i] * std::sin (angle);
+            }
+
+            amount = a;
+        }
+
+        pluginGainStart = std::cos (startAmount * juce::MathConstants<float>::halfPi);
+        pluginGainEnd = std::cos (amount * juce::MathConstants<float>::halfPi);
+    }
+
+private:
+    void pushDry (const juce::AudioBuffer<float>& input, int numChannels, int numSamples, int latency) noexcept
+    {
+        const int capacity = delayLine.getNumSamples();
+        const int readPosition = (writePosition - latency + capacity) % capacity;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            copyIntoRing (delayLine, ch, writePosition, input.getReadPointer (ch), numSamples);
+            copyFromRing (delayLine, ch, readPosition, dry.getWritePointer (ch), numSamples);
+        }
+
+        writePosition = (writePosition + numSamples) % capacity;
+    }
+
+    static void copyIntoRing (juce::AudioBuffer<float>& ring, int ch, int position, const float* src, int n) noexcept
+    {
+        const int first = juce::jmin (n, ring.getNumSamples() - position);
+        juce::FloatVectorOperations::copy (ring.getWritePointer (ch, position), src, first);
+        juce::FloatVectorOperations::copy (ring.getWritePointer (ch), src + first, n - first);
+    }
+
+    static void copyFromRing (const juce::AudioBuffer<float>& ring, int ch, int position, float* dest, int n) noexcept
+    {
+        const int first = juce::jmin (n, ring.getNumSamples() - position);
+        juce::FloatVectorOperations::copy (dest, ring.getReadPointer (ch, position), first);
+        juce::FloatVectorOperations::copy (dest + first, ring.getReadPointer (ch), n - first);
+    }
+
+    void setNative (juce::AudioProcessorParameter* nativeBypass, bool shouldEngage) noexcept
+    {
+        if (nativeBypass == nullptr)
+        {
+            nativeEngaged.store (false);
+            return;
+        }
+
+        if ((nativeBypass->getValue() >= 0.5f) != shouldEngage)
+            nativeBypass->setValue (shouldEngage ? 1.0f : 0.0f);
+
+        nativeEngaged.store (shouldEngage);
+    }
+
+    static constexpr int maxLatency = 1 << 16;
+
+    int blockCapacity = 0;
+    int fadeLength = 1;
+    float amount = 0.0f;        // 0 = plugin, 1 = bypassed
+    bool bypassed = false;
+    float pluginGainStart = 1.0f, pluginGainEnd = 1.0f;
+
+    juce::AudioBuffer<float> delayLine, dry, scratch;
+    int writePosition = 0;
+
+    std::atomic<bool> nativeEngaged { false };
+    std::atomic<int> compensation { 0 };
+};
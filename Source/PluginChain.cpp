@@ -0,0 +1,517 @@
+#include "PluginChain.h"
+#include "ChannelRouting.h"
+#include "MemoryResidency.h"
+
+namespace
+{
+    // One of a member's parameters, seen through the chain. Everything goes straight to
+    // the member's own parameter, so reads and writes from any thread behave as they
+    // would on the member itself.
+    class MemberParameter  : public juce::AudioPluginInstance::HostedParameter
+    {
+    public:
+        MemberParameter (juce::AudioProcessorParameter& memberParameter, const juce::String& memberName, int memberIndex)
+            : target (memberParameter), prefix (memberName + ": "),
+              id ("m" + juce::String (memberIndex) + "." + getMemberParameterID (memberParameter))
+        {
+        }
+
+        float getValue() const override                         { return target.getValue(); }
+        void setValue (float newValue) override                 { target.setValue (newValue); }
+        float getDefaultValue() const override                  { return target.getDefaultValue(); }
+        juce::String getName (int maximumStringLength) const override
+        {
+            return (prefix + target.getName (maximumStringLength)).substring (0, maximumStringLength);
+        }
+
+        juce::String getLabel() const override                  { return target.getLabel(); }
+        int getNumSteps() const override                        { return target.getNumSteps(); }
+        bool isDiscrete() const override                        { return target.isDiscrete(); }
+        bool isBoolean() const override                         { return target.isBoolean(); }
+        bool isOrientationInverted() const override             { return target.isOrientationInverted(); }
+        bool isAutomatable() const override                     { return target.isAutomatable(); }
+        bool isMetaParameter() const override                   { return target.isMetaParameter(); }
+        juce::String getText (float value, int length) const override   { return target.getText (value, length); }
+        float getValueForText (const juce::String& text) const override { return target.getValueForText (text); }
+        juce::String getParameterID() const override            { return id; }
+
+    private:
+        static juce::String getMemberParameterID (juce::AudioProcessorParameter& p)
+        {
+            if (auto* hosted = dynamic_cast<juce::HostedAudioProcessorParameter*> (&p))
+                return hosted->getParameterID();
+
+            return juce::String (p.getParameterIndex());
+        }
+
+        juce::AudioProcessorParameter& target;
+        const juce::String prefix, id;
+    };
+
+    int getWidth (const juce::AudioPluginInstance& plugin) noexcept
+    {
+        return juce::jlimit (2, ChannelRouting::maxPluginChannels,
+                             juce::jmax (plugin.getTotalNumInputChannels(), plugin.getTotalNumOutputChannels()));
+    }
+}
+
+//==============================================================================
+PluginChain::Spec PluginChain::Spec::parse (const juce::String& text)
+{
+    Spec spec;
+
+    for (auto& stageText : juce::StringArray::fromTokens (text, ">", {}))
+    {
+        std::vector<std::vector<int>> stage;
+
+        for (auto& branchText : juce::StringArray::fromTokens (stageText, "|", {}))
+        {
+            std::vector<int> branch;
+
+            for (auto& member : juce::StringArray::fromTokens (branchText, "+", {}))
+            {
+                if (member.trim().isEmpty())
+                    continue;
+
+                branch.push_back (spec.members.size());
+                spec.members.add (member.trim());
+            }
+
+            if (! branch.empty())
+                stage.push_back (std::move (branch));
+        }
+
+        if (! stage.empty())
+            spec.stages.push_back (std::move (stage));
+    }
+
+    return spec;
+}
+
+int PluginChain::Spec::getMaxBranches() const noexcept
+{
+    size_t most = 1;
+
+    for (auto& stage : stages)
+        most = juce::jmax (most, stage.size());
+
+    return (int) most;
+}
+
+juce::String PluginChain::Spec::toString() const
+{
+    juce::StringArray stageTexts;
+
+    for (auto& stage : stages)
+    {
+        juce::StringArray branchTexts;
+
+        for (auto& branch : stage)
+        {
+            juce::StringArray names;
+
+            for (auto member : branch)
+                names.add (members[member]);
+
+            branchTexts.add (names.joinIntoString (" + "));
+        }
+
+        stageTexts.add (branchTexts.joinIntoString (" | "));
+    }
+
+    return stageTexts.joinIntoString (" > ");
+}
+
+//==============================================================================
+PluginChain::PluginChain (const Spec& chainSpec, std::vector<std::unique_ptr<juce::AudioPluginInstance>> chainMembers,
+                          RealtimeWorkerPool& pool, int numWorkers)
+    : juce::AudioPluginInstance (BusesProperties().withInput ("Input", juce::AudioChannelSet::stereo(), true)
+                                                  .withOutput ("Output", juce::AudioChannelSet::stereo(), true)),
+      spec (chainSpec), maxWorkers (numWorkers), members (std::move (chainMembers)), workerPool (pool)
+{
+    jassert ((int) members.size() == spec.members.size());
+
+    for (auto& stageSpec : spec.stages)
+    {
+        stages.emplace_back();
+
+        for (auto& branchSpec : stageSpec)
+        {
+            auto branch = std::make_unique<Branch>();
+
+            for (auto member : branchSpec)
+                if (juce::isPositiveAndBelow (member, (int) members.size()))
+                    branch->plugins.push_back (members[(size_t) member].get());
+
+            stages.back().branches.push_back (std::move (branch));
+        }
+    }
+
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        for (auto* param : members[i]->getParameters())
+            addHostedParameter (std::make_unique<MemberParameter> (*param, members[i]->getName(), (int) i));
+
+        members[i]->addListener (this);
+    }
+}
+
+PluginChain::~PluginChain()
+{
+    for (auto& member : members)
+        member->removeListener (this);
+}
+
+juce::String PluginChain::applyMemberLayout (juce::AudioPluginInstance& member)
+{
+    // An unconfigured routing asks for a stereo main bus and nothing else.
+    return ChannelRouting().applyLayout (member);
+}
+
+int PluginChain::getMaxBranches() const noexcept
+{
+    return spec.getMaxBranches();
+}
+
+// The most threads the branches can run on, if the pool's workers are free.
+int PluginChain::getNumThreads() const noexcept
+{
+    const int wanted = maxWorkers >= 0 ? maxWorkers : getMaxBranches() - 1;
+    return juce::jmin (wanted, workerPool.getNumWorkers(), getMaxBranches() - 1) + 1;
+}
+
+const juce::String PluginChain::getName() const
+{
+    juce::StringArray stageNames;
+
+    for (auto& stage : stages)
+    {
+        juce::StringArray branchNames;
+
+        for (auto& branch : stage.branches)
+        {
+            juce::StringArray names;
+
+            for (auto* plugin : branch->plugins)
+                names.add (plugin->getName());
+
+            branchNames.add (names.joinIntoString (" + "));
+        }
+
+        stageNames.add (branchNames.joinIntoString (" | "));
+    }
+
+    return stageNames.joinIntoString (" > ");
+}
+
+void PluginChain::fillInPluginDescription (juce::PluginDescription& description) const
+{
+    const auto text = spec.toString();
+
+    description.name = getName();
+    description.descriptiveName = "Plugin chain";
+    description.pluginFormatName = "Chain";
+    description.category = "Effect";
+    description.manufacturerName = "starnails";
+    description.version = "1.0";
+    description.fileOrIdentifier = "chain:" + text;
+    description.uniqueId = text.hashCode();
+    description.isInstrument = false;
+    description.numInputChannels = 2;
+    description.numOutputChannels = 2;
+}
+
+bool PluginChain::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+    return layouts.inputBuses.size() == 1 && layouts.outputBuses.size() == 1
+        && layouts.getMainInputChannelSet() == juce::AudioChannelSet::stereo()
+        && layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo();
+}
+
+//==============================================================================
+// Members the loader has already prepared for these settings are left alone, so
+// building a chain doesn't prepare every plugin twice.
+void PluginChain::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    for (auto& member : members)
+    {
+        if (member->getSampleRate() == sampleRate && member->getBlockSize() >= maximumExpectedSamplesPerBlock)
+            continue;
+
+        member->releaseResources();
+        applyMemberLayout (*member);
+        member->setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+        member->prepareToPlay (sampleRate, maximumExpectedSamplesPerBlock);
+    }
+
+    for (auto& stage : stages)
+    {
+        for (auto& branch : stage.branches)
+        {
+            int width = 2;
+
+            for (auto* plugin : branch->plugins)
+                width = juce::jmax (width, getWidth (*plugin));
+
+            branch->buffer.setSize (width, juce::jmax (1, maximumExpectedSamplesPerBlock), false, true, false);
+            branch->midi.ensureSize (midiBufferBytes);
+            MemoryResidency::prefault (branch->buffer);
+
+            // A lone branch is never delayed.
+            if (stage.branches.size() > 1 && branch->delayLine.getNumSamples() != maxCompensation)
+            {
+                branch->delayLine.setSize (2, maxCompensation, false, true, false);
+                branch->delayLine.clear();
+                branch->delayPosition = 0;
+                MemoryResidency::prefault (branch->delayLine);
+            }
+        }
+    }
+
+    updateLatency();
+}
+
+// The members stay prepared, like every other instance the pipeline holds, and the
+// workers belong to the pipeline.
+void PluginChain::releaseResources()
+{
+}
+
+// Often called on the audio thread, in the middle of a member's processBlock; the
+// change is applied at the start of the chain's next block.
+void PluginChain::audioProcessorChanged (juce::AudioProcessor*, const juce::AudioProcessorListener::ChangeDetails& details)
+{
+    if (details.latencyChanged)
+        latencyStale.store (true);
+}
+
+// Doesn't allocate, so the render thread can call it between blocks. The chain itself has
+// no listeners, so reporting the new total doesn't lock either.
+void PluginChain::updateLatency()
+{
+    latencyStale.store (false);
+    int total = 0;
+
+    for (auto& stage : stages)
+    {
+        stage.latency = 0;
+
+        for (auto& branch : stage.branches)
+        {
+            branch->latency = 0;
+
+            for (auto* plugin : branch->plugins)
+                branch->latency += plugin->getLatencySamples();
+
+            stage.latency = juce::jmax (stage.latency, branch->latency);
+        }
+
+        // The history already in the delay lines stays valid; only the read point moves.
+        for (auto& branch : stage.branches)
+        {
+            jassert (stage.latency - branch->latency < maxCompensation);
+            branch->delaySamples = juce::jlimit (0, juce::jmax (0, branch->delayLine.getNumSamples() - 1),
+                                                 stage.latency - branch->latency);
+        }
+
+        total += stage.latency;
+    }
+
+    setLatencySamples (total);
+}
+
+void PluginChain::reset()
+{
+    for (auto& member : members)
+        member->reset();
+
+    for (auto& stage : stages)
+    {
+        for (auto& branch : stage.branches)
+        {
+            branch->delayLine.clear();
+            branch->delayPosition = 0;
+        }
+    }
+}
+
+double PluginChain::getTailLengthSeconds() const
+{
+    double total = 0.0;
+
+    for (auto& stage : stages)
+    {
+        double longest = 0.0;
+
+        for (auto& branch : stage.branches)
+        {
+            double tail = 0.0;
+
+            for (auto* plugin : branch->plugins)
+                tail += plugin->getTailLengthSeconds();
+
+            longest = juce::jmax (longest, tail);
+        }
+
+        total += longest;
+    }
+
+    return total;
+}
+
+bool PluginChain::acceptsMidi() const
+{
+    for (auto& member : members)
+        if (member->acceptsMidi())
+            return true;
+
+    return false;
+}
+
+//==============================================================================
+void PluginChain::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = juce::jmin (2, buffer.getNumChannels());
+
+    // More than we prepared for; leave the input as it is.
+    if (stages.empty() || numSamples > stages.front().branches.front()->buffer.getNumSamples())
+        return;
+
+    if (latencyStale.load())
+        updateLatency();
+
+    // A standby warming up on the message thread leaves the workers to the live instances.
+    const int branchWorkers = juce::MessageManager::existsAndIsCurrentThread() ? 0 : maxWorkers;
+
+    for (auto& stage : stages)
+    {
+        const auto& branches = stage.branches;
+
+        auto runBranch = [this, &branches, &buffer, &midi] (int branchIndex)
+        {
+            // FTZ/DAZ are per thread, and this may be running on a pool worker.
+            juce::ScopedNoDenormals noDenormals;
+            processBranch (*branches[(size_t) branchIndex], buffer, midi);
+        };
+
+        workerPool.run ((int) branches.size(), runBranch, branchWorkers);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            buffer.copyFrom (ch, 0, branches.front()->buffer, ch, 0, numSamples);
+
+            for (size_t i = 1; i < branches.size(); ++i)
+                buffer.addFrom (ch, 0, branches[i]->buffer, ch, 0, numSamples);
+
+            if (branches.size() > 1)
+                buffer.applyGain (ch, 0, numSamples, 1.0f / (float) branches.size());
+        }
+    }
+
+    midi.clear();
+}
+
+// Runs one branch on its own buffer. Only reads input and midi, so all the branches of a
+// stage can run at once.
+void PluginChain::processBranch (Branch& branch, const juce::AudioBuffer<float>& input, const juce::MidiBuffer& midi) noexcept
+{
+    const int numSamples = input.getNumSamples();
+    const int numInputChannels = juce::jmin (2, input.getNumChannels());
+    auto& work = branch.buffer;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        if (ch < numInputChannels)
+            work.copyFrom (ch, 0, input, ch, 0, numSamples);
+        else
+            work.clear (ch, 0, numSamples);
+    }
+
+    for (auto* plugin : branch.plugins)
+    {
+        // Extra channels are an extra plugin's sidechain or aux outputs, which carry
+        // nothing from one plugin to the next.
+        const int width = juce::jmin (work.getNumChannels(), getWidth (*plugin));
+
+        for (int ch = 2; ch < width; ++ch)
+            work.clear (ch, 0, numSamples);
+
+        // Each plugin gets the chain's events; plugins are free to rewrite the buffer.
+        branch.midi.clear();
+        branch.midi.addEvents (midi, 0, -1, 0);
+
+        juce::AudioBuffer<float> view (work.getArrayOfWritePointers(), width, numSamples);
+        plugin->processBlock (view, branch.midi);
+    }
+
+    // Written even while the branch needs no delay, so a later change has history to read.
+    const int length = branch.delayLine.getNumSamples();
+
+    if (length == 0)
+        return;
+
+    const int delay = branch.delaySamples;
+    int position = branch.delayPosition;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        auto* line = branch.delayLine.getWritePointer (ch);
+        auto* samples = work.getWritePointer (ch);
+        position = branch.delayPosition;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            line[position] = samples[i];
+
+            if (delay > 0)
+                samples[i] = line[position >= delay ? position - delay : position - delay + length];
+
+            if (++position == length)
+                position = 0;
+        }
+    }
+
+    branch.delayPosition = position;
+}
+
+//==============================================================================
+void PluginChain::getStateInformation (juce::MemoryBlock& destData)
+{
+    juce::XmlElement xml ("PLUGINCHAIN");
+
+    for (auto& member : members)
+    {
+        juce::MemoryBlock state;
+        member->getStateInformation (state);
+        xml.createNewChildElement ("MEMBER")->addTextElement (state.toBase64Encoding());
+    }
+
+    copyXmlToBinary (xml, destData);
+}
+
+void PluginChain::setStateInformation (const void* data, int sizeInBytes)
+{
+    auto xml = getXmlFromBinary (data, sizeInBytes);
+
+    if (xml == nullptr || ! xml->hasTagName ("PLUGINCHAIN"))
+        return;
+
+    size_t member = 0;
+
+    for (auto* child : xml->getChildWithTagNameIterator ("MEMBER"))
+    {
+        if (member >= members.size())
+            break;
+
+        juce::MemoryBlock state;
+
+        if (state.fromBase64Encoding (child->getAllSubText()))
+            members[member]->setStateInformation (state.getData(), (int) state.getSize());
+
+        ++member;
+    }
+
+    // A member's latency can depend on its settings.
+    updateLatency();
+}
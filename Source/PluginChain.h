@@ -0,0 +1,122 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeWorkerPool.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Several plugins hosted as one instance: a series of stages, where each stage is either
+// a single plugin or a set of branches that all take the stage's input and whose outputs
+// are averaged. A branch is itself a series of plugins. Written as
+//
+//     PreEQ.dll > Stardust.dll | Exciter.dll + Widener.dll > Limiter.dll
+//
+// with ">" between stages, "|" between parallel branches and "+" between plugins in a
+// branch.
+//
+// Latency is compensated inside the chain: every branch is delayed up to the slowest
+// branch of its stage, and the chain reports the stages' sum, so bypass and everything
+// else downstream see one plugin with one latency. It is worked out again when the
+// chain is prepared or given a new state, and at the start of the next block when a
+// member reports a latency change while live. The delay lines are allocated up front at
+// their largest, so that never allocates.
+// The branches of a stage run in parallel, inside the same processBlock call, on the
+// hosting pipeline's real-time worker pool. The chain starts no threads of its own:
+// when the pipeline's pairs already have the workers busy, its branches simply run one
+// after another.
+//
+// The members' parameters are exposed as the chain's own, prefixed with the member's
+// name, and the chain's state holds every member's state. As a plugin instance it goes
+// through hot swaps, presets, bypass and the watchdog like any other.
+class PluginChain  : public juce::AudioPluginInstance,
+                     private juce::AudioProcessorListener
+{
+public:
+    struct Spec
+    {
+        juce::StringArray members;                          // plugin files, one entry per member
+        std::vector<std::vector<std::vector<int>>> stages;  // stage, branch, then indices into members
+
+        static Spec parse (const juce::String& text);
+        juce::String toString() const;
+        bool isEmpty() const noexcept                       { return members.isEmpty(); }
+        int getMaxBranches() const noexcept;
+    };
+
+    // members are in the spec's order and not yet shared with anything. pool must outlive
+    // any processing; numWorkers is the most of its workers the branches may use, -1 for
+    // one per extra branch.
+    PluginChain (const Spec& chainSpec, std::vector<std::unique_ptr<juce::AudioPluginInstance>> members,
+                 RealtimeWorkerPool& pool, int numWorkers);
+    ~PluginChain() override;
+
+    // Loader thread. Members get a plain stereo layout; the chain does the routing.
+    static juce::String applyMemberLayout (juce::AudioPluginInstance& member);
+
+    int getNumMembers() const noexcept                          { return (int) members.size(); }
+    int getMaxBranches() const noexcept;
+    int getNumThreads() const noexcept;
+
+    //==============================================================================
+    const juce::String getName() const override;
+    void fillInPluginDescription (juce::PluginDescription& description) const override;
+
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void reset() override;
+    void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) override;
+
+    double getTailLengthSeconds() const override;
+    bool acceptsMidi() const override;
+    bool producesMidi() const override                          { return false; }
+    juce::AudioProcessorEditor* createEditor() override         { return nullptr; }
+    bool hasEditor() const override                             { return false; }
+
+    int getNumPrograms() override                               { return 1; }
+    int getCurrentProgram() override                            { return 0; }
+    void setCurrentProgram (int) override {}
+    const juce::String getProgramName (int) override            { return {}; }
+    void changeProgramName (int, const juce::String&) override {}
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+private:
+    struct Branch
+    {
+        std::vector<juce::AudioPluginInstance*> plugins;
+        int latency = 0;
+        int delaySamples = 0;               // added to line up with the stage's slowest branch
+        juce::AudioBuffer<float> buffer;    // as wide as its widest plugin
+        juce::AudioBuffer<float> delayLine; // maxCompensation long, only in stages with several branches
+        int delayPosition = 0;
+        juce::MidiBuffer midi;
+    };
+
+    struct Stage
+    {
+        std::vector<std::unique_ptr<Branch>> branches;
+        int latency = 0;
+    };
+
+    void processBranch (Branch& branch, const juce::AudioBuffer<float>& input, const juce::MidiBuffer& midi) noexcept;
+    void updateLatency();
+
+    // Members may call these from any thread, the audio thread included.
+    void audioProcessorParameterChanged (juce::AudioProcessor*, int, float) override {}
+    void audioProcessorChanged (juce::AudioProcessor*, const juce::AudioProcessorListener::ChangeDetails& details) override;
+
+    static constexpr int midiBufferBytes = 4096;
+    static constexpr int maxCompensation = 1 << 15;  // samples one branch can be delayed by
+
+    const Spec spec;
+    const int maxWorkers;
+    std::vector<std::unique_ptr<juce::AudioPluginInstance>> members;
+    std::vector<Stage> stages;
+    RealtimeWorkerPool& workerPool;
+    std::atomic<bool> latencyStale { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginChain)
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryResidency.h"
+#include <array>
+#include <atomic>
+#include <functional>
+
+// Swaps plugin instances under a running audio callback without locks.
+//
+// The message thread prepares a new instance and hands it over with submit(). The audio
+// thread picks it up with an atomic exchange at the start of its next block and crossfades
+// from the outgoing instance over a configurable number of blocks. The fade is counted in
+// samples, so a block split at parameter changes doesn't shorten it. Instances leaving
+// the audio path go back through a lock-free FIFO and are released and destroyed by
+// collectRetired() on the message thread, which plugin formats expect to own their
+// teardown, so the callback never runs a plugin destructor.
+//
+// Submissions carry a batch number, and the audio thread only picks up batches that
+// have been released to it, so several swaps can be made to change over on the same
+// block. A submission can also ask for the instance it replaces to be recycled: that
+// one comes back to the message thread still prepared, for reuse.
+class PluginHotSwap
+{
+public:
+    PluginHotSwap() = default;
+
+    ~PluginHotSwap()
+    {
+        // The audio callback must already be stopped at this point.
+        collectRetired();
+
+        while (auto recycled = takeRecycled())
+            recycled.reset();
+
+        delete pending.exchange (nullptr);
+        delete fadingOut;
+        delete active;
+    }
+
+    //==============================================================================
+    // Message thread. The instance should already be prepared for the current device
+    // settings; if the device is not running yet, prepareToPlay() will do it. It goes
+    // live once beginBlock() is given a released batch at least this one.
+    void submit (std::unique_ptr<juce::AudioPluginInstance> instance, juce::uint32 batch, bool recycleOutgoing = false)
+    {
+        // An instance that was never picked up has not touched the audio path, so it
+        // is safe to drop it right here.
+        if (instance != nullptr)
+            anySubmitted.store (true);
+
+        // The batch and recycle flag travel in the same record as the instance, so the
+        // audio thread can never pair one submission's instance with another's flags.
+        auto* entry = instance != nullptr ? new Entry { std::move (instance), batch, recycleOutgoing } : nullptr;
+        delete pending.exchange (entry, std::memory_order_acq_rel);
+    }
+
+    // Message thread, called regularly. Releases and destroys the instances the audio
+    // thread has finished with.
+    void collectRetired()
+    {
+        int start1, size1, start2, size2;
+        retireFifo.prepareToRead (retireFifo.getNumReady(), start1, size1, start2, size2);
+
+        auto destroy = [this] (int start, int size)
+        {
+            for (int i = start; i < start + size; ++i)
+            {
+                std::unique_ptr<Entry> doomed (retireSlots[(size_t) i]);
+                retireSlots[(size_t) i] = nullptr;
+                doomed->instance->releaseResources();
+            }
+        };
+
+        destroy (start1, size1);
+        destroy (start2, size2);
+        retireFifo.finishedRead (size1 + size2);
+    }
+
+    // Message thread. An instance replaced by a recycling submit, once the audio thread
+    // has finished with it, or nullptr.
+    std::unique_ptr<juce::AudioPluginInstance> takeRecycled()
+    {
+        int start1, size1, start2, size2;
+        recycleFifo.prepareToRead (1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+            return {};
+
+        std::unique_ptr<Entry> entry (recycleSlots[(size_t) start1]);
+        recycleSlots[(size_t) start1] = nullptr;
+        recycleFifo.finishedRead (1);
+        return std::move (entry->instance);
+    }
+
+    // Any thread. True while a submitted instance hasn't been picked up or the previous
+    // one is still fading out.
+    bool isSwapping() const noexcept     { return pending.load() != nullptr || fadeActive.load(); }
+
+    // Any thread. True once something has been submitted, even if the render thread
+    // hasn't picked it up yet.
+    bool hasInstance() const noexcept    { return anySubmitted.load(); }
+
+    void setCrossfadeBlocks (int numBlocks) noexcept
+    {
+        crossfadeBlocks.store (juce::jmax (0, numBlocks));
+    }
+
+    // Message thread, only while the audio callback is stopped. numChannels is the widest
+    // buffer process() will be given; prepareInstance sets up and prepares each instance.
+    void prepareToPlay (int maxBlockSize, int numChannels, const std::function<void (juce::AudioPluginInstance&)>& prepareInstance)
+    {
+        blockSize = maxBlockSize;
+        fadeBuffer.setSize (numChannels, maxBlockSize, false, true, false);
+        fadeBuffer.clear();
+        MemoryResidency::prefault (fadeBuffer);
+        fadeMidi.ensureSize (256);
+
+        forEachInstance ([&] (juce::AudioPluginInstance& p) { prepareInstance (p); });
+    }
+
+    // Message thread, only while the audio callback is stopped.
+    void releaseResources()
+    {
+        forEachInstance ([] (juce::AudioPluginInstance& p) { p.releaseResources(); });
+    }
+
+    //==============================================================================
+    // Audio thread. Publishes a pending instance if there is one and its batch has been
+    // released, and returns whether any instance is live for this block.
+    bool beginBlock (juce::uint32 releasedBatch) noexcept
+    {
+        if (fadingOut == nullptr && pending.load (std::memory_order_acquire) != nullptr)
+        {
+            // Take ownership before looking inside: once exchanged out, the message
+            // thread can no longer replace and delete the record under us.
+            auto* incoming = pending.exchange (nullptr, std::memory_order_acq_rel);
+
+            if (incoming != nullptr && (int) (incoming->batch - releasedBatch) > 0)
+            {
+                // Not released yet, so put it back. If a newer submission arrived in the
+                // meantime this one has been superseded and never went live.
+                Entry* expected = nullptr;
+
+                if (! pending.compare_exchange_strong (expected, incoming, std::memory_order_acq_rel))
+                    retire (incoming);
+
+                incoming = nullptr;
+            }
+
+            if (incoming != nullptr)
+            {
+                const bool recycle = incoming->recycle;
+                // Counted in samples: process() may be handed a block in several pieces.
+                fadeLength = crossfadeBlocks.load() * blockSize;
+
+                if (active != nullptr && fadeLength > 0)
+                {
+                    fadingOut = active;
+                    fadingOutRecycles = recycle;
+                    fadePosition = 0;
+                    fadeActive.store (true);
+                }
+                else if (active != nullptr)
+                {
+                    retire (active, recycle);
+                }
+
+                active = incoming;
+            }
+        }
+
+        return active != nullptr;
+    }
+
+    // Audio thread, after beginBlock() returned true.
+    juce::AudioPluginInstance* getActive() const noexcept    { return active != nullptr ? active->instance.get() : nullptr; }
+
+    // Audio thread, after beginBlock() returned true.
+    void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept
+    {
+        jassert (active != nullptr);
+
+        const int numSamples = buffer.getNumSamples();
+        const int numChannels = buffer.getNumChannels();
+
+        if (fadingOut != nullptr && (numSamples > fadeBuffer.getNumSamples()
+                                      || numChannels > fadeBuffer.getNumChannels()
+                                      || getNumPluginChannels (*fadingOut->instance) > numChannels))
+        {
+            // The device handed us more than we prepared for, or the outgoing plugin
+            // has a wider layout than the buffer laid out for the new one; cut over.
+            endFade();
+        }
+
+        if (fadingOut == nullptr)
+        {
+            active->instance->processBlock (buffer, midi);
+            return;
+        }
+
+        juce::AudioBuffer<float> fadeView (fadeBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            fadeView.copyFrom (ch, 0, buffer, ch, 0, numSamples);
+
+        fadeMidi.clear();
+        fadingOut->instance->processBlock (fadeView, fadeMidi);
+        active->instance->processBlock (buffer, midi);
+
+        const float gainStart = (float) fadePosition / (float) fadeLength;
+        const float gainEnd = (float) juce::jmin (fadePosition + numSamples, fadeLength) / (float) fadeLength;
+
+        // Channels past the outputs may be inputs shared with other instances.
+        const int numOutputs = juce::jmin (numChannels, active->instance->getTotalNumOutputChannels());
+
+        for (int ch = 0; ch < numOutputs; ++ch)
+        {
+            buffer.applyGainRamp (ch, 0, numSamples, gainStart, gainEnd);
+            buffer.addFromWithRamp (ch, 0, fadeView.getReadPointer (ch), numSamples,
+                                    1.0f - gainStart, 1.0f - gainEnd);
+        }
+
+        fadePosition += numSamples;
+
+        if (fadePosition >= fadeLength)
+            endFade();
+    }
+
+private:
+    // An instance together with the submission it arrived in. It stays attached to the
+    // instance until the message thread destroys or recycles it, so the audio thread
+    // never has to allocate or free one.
+    struct Entry
+    {
+        std::unique_ptr<juce::AudioPluginInstance> instance;
+        juce::uint32 batch = 0;
+        bool recycle = false;
+    };
+
+    static int getNumPluginChannels (const juce::AudioPluginInstance& p) noexcept
+    {
+        return juce::jmax (p.getTotalNumInputChannels(), p.getTotalNumOutputChannels());
+    }
+
+    template <typename Fn>
+    void forEachInstance (Fn&& fn)
+    {
+        for (auto* e : { active, fadingOut, pending.load() })
+            if (e != nullptr)
+                fn (*e->instance);
+    }
+
+    void endFade() noexcept
+    {
+        retire (fadingOut, fadingOutRecycles);
+        fadingOut = nullptr;
+        fadeActive.store (false);
+    }
+
+    void retire (Entry* entry, bool recycle = false) noexcept
+    {
+        int start1, size1, start2, size2;
+
+        if (recycle)
+        {
+            recycleFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+            if (size1 == 1)
+            {
+                recycleSlots[(size_t) start1] = entry;
+                recycleFifo.finishedWrite (1);
+                return;
+            }
+
+            // Nobody is collecting them; destroy this one as usual.
+        }
+
+        retireFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        // Swaps are operator-paced and the message thread collects several times a
+        // second, so a full FIFO means something is badly wrong. Leaking the instance
+        // is still better than destroying it on the audio thread.
+        jassert (size1 == 1);
+
+        if (size1 == 1)
+            retireSlots[(size_t) start1] = entry;
+
+        retireFifo.finishedWrite (size1);
+    }
+
+    static constexpr int retireCapacity = 32;
+
+    std::atomic<Entry*> pending { nullptr };
+    std::atomic<bool> fadeActive { false };
+    std::atomic<int> crossfadeBlocks { 8 };
+    std::atomic<bool> anySubmitted { false };
+
+    // Owned by the audio thread while the device runs.
+    Entry* active = nullptr;
+    Entry* fadingOut = nullptr;
+    bool fadingOutRecycles = false;
+    int blockSize = 0;
+    int fadePosition = 0;       // samples
+    int fadeLength = 0;
+    juce::AudioBuffer<float> fadeBuffer;
+    juce::MidiBuffer fadeMidi;
+
+    juce::AbstractFifo retireFifo { retireCapacity };
+    std::array<Entry*, (size_t) retireCapacity> retireSlots {};
+    juce::AbstractFifo recycleFifo { retireCapacity };
+    std::array<Entry*, (size_t) retireCapacity> recycleSlots {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginHotSwap)
+};
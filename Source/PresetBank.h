@@ -0,0 +1,110 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "EngineSettings.h"
+#include <array>
+
+// A handful of plugin state snapshots (A, B, C, D), taken with getStateInformation and
+// kept in memory so recalling one never has to serialise anything. They are saved with
+// the pipeline's settings and only restored for the plugin they were taken from. Each
+// snapshot also keeps the normalised parameter values, which is what morphing blends.
+//
+// Message thread only.
+class PresetBank
+{
+public:
+    static constexpr int numSlots = 4;
+
+    explicit PresetBank (const juce::String& key) : settingsKey (key) {}
+
+    static juce::String getSlotName (int slot)     { return juce::String::charToString ((juce::juce_wchar) ('A' + slot)); }
+
+    bool hasSnapshot (int slot) const noexcept
+    {
+        return juce::isPositiveAndBelow (slot, numSlots) && slots[(size_t) slot].getSize() > 0;
+    }
+
+    const juce::MemoryBlock& getSnapshot (int slot) const noexcept  { return slots[(size_t) slot]; }
+    const juce::Array<float>& getValues (int slot) const noexcept    { return values[(size_t) slot]; }
+
+    void store (int slot, juce::AudioProcessor& processor)
+    {
+        if (! juce::isPositiveAndBelow (slot, numSlots))
+            return;
+
+        slots[(size_t) slot].reset();
+        processor.getStateInformation (slots[(size_t) slot]);
+
+        auto& slotValues = values[(size_t) slot];
+        slotValues.clearQuick();
+
+        for (auto* param : processor.getParameters())
+            slotValues.add (param->getValue());
+
+        save();
+    }
+
+    // Switches the bank to another plugin, restoring whatever was saved for it.
+    void setPlugin (const juce::String& identifier)
+    {
+        if (identifier == pluginIdentifier)
+            return;
+
+        pluginIdentifier = identifier;
+
+        for (auto& slot : slots)
+            slot.reset();
+
+        for (auto& slotValues : values)
+            slotValues.clear();
+
+        auto xml = EngineSettings::loadXml (settingsKey);
+
+        if (xml == nullptr || xml->getStringAttribute ("plugin") != pluginIdentifier)
+            return;
+
+        for (auto* child : xml->getChildWithTagNameIterator ("SLOT"))
+        {
+            const int slot = child->getIntAttribute ("index", -1);
+
+            if (! juce::isPositiveAndBelow (slot, numSlots))
+                continue;
+
+            slots[(size_t) slot].fromBase64Encoding (child->getAllSubText());
+
+            for (auto& token : juce::StringArray::fromTokens (child->getStringAttribute ("values"), false))
+                values[(size_t) slot].add (token.getFloatValue());
+        }
+    }
+
+private:
+    void save() const
+    {
+        juce::XmlElement xml ("PRESETS");
+        xml.setAttribute ("plugin", pluginIdentifier);
+
+        for (int slot = 0; slot < numSlots; ++slot)
+        {
+            if (! hasSnapshot (slot))
+                continue;
+
+            auto* child = xml.createNewChildElement ("SLOT");
+            child->setAttribute ("index", slot);
+
+            juce::StringArray tokens;
+
+            for (auto value : values[(size_t) slot])
+                tokens.add (juce::String (value));
+
+            child->setAttribute ("values", tokens.joinIntoString (" "));
+            child->addTextElement (slots[(size_t) slot].toBase64Encoding());
+        }
+
+        EngineSettings::storeXml (settingsKey, xml);
+    }
+
+    const juce::String settingsKey;
+    juce::String pluginIdentifier;
+    std::array<juce::MemoryBlock, (size_t) numSlots> slots;
+    std::array<juce::Array<float>, (size_t) numSlots> values;
+};
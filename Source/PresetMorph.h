@@ -0,0 +1,159 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetBank.h"
+#include "SimdFloat4.h"
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Glides the plugin between the preset snapshots from an XY position. A, B, C and D sit
+// at the top-left, top-right, bottom-left and bottom-right corners, and each parameter
+// gets the bilinear blend of the snapshots' normalised values. Missing snapshots drop
+// out and the remaining weights are scaled back up to one.
+//
+// The blend runs on the render thread once per block, four parameters per step, and only
+// parameters whose blended value actually moved are pushed into the plugin. A still
+// position costs nothing; a moving one costs one pass over the parameters per block, no
+// matter how fast the UI sends positions. New snapshot tables come from the message
+// thread through a triple buffer, and the position is a single packed atomic.
+class PresetMorph
+{
+public:
+    // Message thread. Takes the bank's current snapshots; ones taken with a different
+    // parameter count are left out. Every parameter is pushed again on the next move,
+    // so call this too whenever the plugin's state has changed behind the morph's back.
+    void setSnapshots (const PresetBank& bank, int numParameters)
+    {
+        auto& table = tables[(size_t) back];
+        const size_t padded = (size_t) ((numParameters + 3) & ~3);
+
+        table.numParameters = numParameters;
+        numSnapshots = 0;
+
+        for (int slot = 0; slot < PresetBank::numSlots; ++slot)
+        {
+            const auto& values = bank.getValues (slot);
+            auto& snapshot = table.snapshots[(size_t) slot];
+
+            snapshot.assign (padded, 0.0f);
+            table.present[(size_t) slot] = bank.hasSnapshot (slot) && values.size() == numParameters;
+
+            if (table.present[(size_t) slot])
+            {
+                std::copy (values.begin(), values.end(), snapshot.begin());
+                ++numSnapshots;
+            }
+        }
+
+        table.morphed.assign (padded, 0.0f);
+        table.pushed.assign (padded, -1.0f);
+
+        back = middle.exchange (back | freshFlag) & indexMask;
+    }
+
+    // Message thread. Morphing needs something to move between.
+    bool canMorph() const noexcept              { return numSnapshots >= 2; }
+
+    // Message thread. x and y run from 0 to 1.
+    void setPosition (float x, float y) noexcept
+    {
+        lastX = juce::jlimit (0.0f, 1.0f, x);
+        lastY = juce::jlimit (0.0f, 1.0f, y);
+        position.store (((juce::uint32) juce::roundToInt (lastX * 65535.0f) << 16)
+                        | (juce::uint32) juce::roundToInt (lastY * 65535.0f));
+    }
+
+    float getX() const noexcept                 { return lastX; }
+    float getY() const noexcept                 { return lastY; }
+
+    // Message thread. True if anything has been pushed since the last call.
+    bool takeChanged() noexcept                 { return changed.exchange (false); }
+
+    // Render thread, once per block. Calls apply (index, value) for each parameter whose
+    // blended value has moved since it was last pushed.
+    template <typename ApplyFn>
+    void process (ApplyFn&& apply) noexcept
+    {
+        if ((middle.load() & freshFlag) != 0)
+            front = middle.exchange (front) & indexMask;
+
+        const auto packed = position.load();
+
+        if (packed == lastPosition)
+            return;
+
+        lastPosition = packed;
+        auto& table = tables[(size_t) front];
+
+        const float x = (float) (packed >> 16) / 65535.0f;
+        const float y = (float) (packed & 0xffff) / 65535.0f;
+        float weights[PresetBank::numSlots] = { (1.0f - x) * (1.0f - y), x * (1.0f - y), (1.0f - x) * y, x * y };
+        float total = 0.0f;
+
+        for (int slot = 0; slot < PresetBank::numSlots; ++slot)
+        {
+            if (! table.present[(size_t) slot])
+                weights[slot] = 0.0f;
+
+            total += weights[slot];
+        }
+
+        if (total <= 0.0f)
+            return;
+
+        const Float4 wA (weights[0] / total), wB (weights[1] / total), wC (weights[2] / total), wD (weights[3] / total);
+        const float* a = table.snapshots[0].data();
+        const float* b = table.snapshots[1].data();
+        const float* c = table.snapshots[2].data();
+        const float* d = table.snapshots[3].data();
+        float* morphed = table.morphed.data();
+        const int padded = (int) table.morphed.size();
+
+        for (int i = 0; i < padded; i += 4)
+            (wA * Float4::load (a + i) + wB * Float4::load (b + i) + wC * Float4::load (c + i) + wD * Float4::load (d + i)).store (morphed + i);
+
+        int numPushed = 0;
+
+        for (int i = 0; i < table.numParameters; ++i)
+        {
+            if (std::abs (morphed[i] - table.pushed[(size_t) i]) < threshold)
+                continue;
+
+            table.pushed[(size_t) i] = morphed[i];
+            apply (i, morphed[i]);
+            ++numPushed;
+        }
+
+        if (numPushed > 0)
+            changed.store (true);
+    }
+
+private:
+    struct Table
+    {
+        int numParameters = 0;
+        std::array<bool, (size_t) PresetBank::numSlots> present {};
+        std::array<std::vector<float>, (size_t) PresetBank::numSlots> snapshots;   // padded to a multiple of four
+        std::vector<float> morphed;
+        std::vector<float> pushed;
+    };
+
+    static constexpr int freshFlag = 4;
+    static constexpr int indexMask = 3;
+    static constexpr float threshold = 1.0e-4f;   // smaller moves than this aren't worth a setValue
+
+    // Triple buffer: the message thread fills back, the render thread reads front, and
+    // middle holds the latest table published but not yet picked up.
+    std::array<Table, 3> tables;
+    std::atomic<int> middle { 1 };
+    int back = 2;       // message thread
+    int front = 0;      // render thread
+
+    std::atomic<juce::uint32> position { 0 };
+    juce::uint32 lastPosition = 0;      // render thread
+    float lastX = 0.0f, lastY = 0.0f;   // message thread
+    int numSnapshots = 0;               // message thread
+
+    std::atomic<bool> changed { false };
+};
@@ -0,0 +1,207 @@
+#include "RealtimeScheduling.h"
+#include <atomic>
+#include <cstring>
+
+#if JUCE_LINUX || JUCE_BSD
+ #include <pthread.h>
+ #include <sched.h>
+ #include <cerrno>
+#endif
+
+namespace
+{
+    // Written once by configure() before any audio thread starts, read-only afterwards.
+    struct State
+    {
+        int policy = 0;            // 0 = leave the scheduler alone
+        juce::String policyName;
+        int audioPriority = 0;
+        int workerPriority = 0;
+        juce::Array<int> audioCores;
+        juce::Array<int> uiCores;
+
+        // Failure reporting from threads that can't log. Only the first failure per
+        // kind is kept; that is what an operator needs to fix.
+        std::atomic<int> priorityError { 0 };
+        std::atomic<int> affinityError { 0 };
+        std::atomic<int> failedPriority { 0 };
+        std::atomic<juce::uint32> failureCount { 0 };
+        juce::uint32 reportedCount = 0;
+    };
+
+    State& getState()
+    {
+        static State state;
+        return state;
+    }
+
+    juce::String describeCores (const juce::Array<int>& cores)
+    {
+        juce::StringArray names;
+
+        for (auto core : cores)
+            names.add (juce::String (core));
+
+        return names.joinIntoString (",");
+    }
+
+    int setAffinity (const int* cores, int numCores) noexcept
+    {
+        if (numCores <= 0)
+            return 0;
+
+       #if JUCE_LINUX || JUCE_BSD
+        cpu_set_t set;
+        CPU_ZERO (&set);
+
+        for (int i = 0; i < numCores; ++i)
+            if (const int core = cores[i]; juce::isPositiveAndBelow (core, CPU_SETSIZE))
+                CPU_SET ((size_t) core, &set);
+
+        return pthread_setaffinity_np (pthread_self(), sizeof (set), &set);
+       #else
+        juce::uint32 mask = 0;
+
+        for (int i = 0; i < numCores; ++i)
+            if (const int core = cores[i]; juce::isPositiveAndBelow (core, 32))
+                mask |= (juce::uint32) 1 << core;
+
+        juce::Thread::setCurrentThreadAffinityMask (mask);
+        return 0;
+       #endif
+    }
+
+    int setAffinity (const juce::Array<int>& cores) noexcept
+    {
+        return setAffinity (cores.begin(), cores.size());
+    }
+
+    int setPriority (int policy, int priority) noexcept
+    {
+       #if JUCE_LINUX || JUCE_BSD
+        if (policy == 0)
+            return 0;
+
+        sched_param param;
+        std::memset (&param, 0, sizeof (param));
+        param.sched_priority = juce::jlimit (sched_get_priority_min (policy), sched_get_priority_max (policy), priority);
+        return pthread_setschedparam (pthread_self(), policy, &param);
+       #else
+        juce::ignoreUnused (policy, priority);
+        return 0;
+       #endif
+    }
+
+    void recordFailure (std::atomic<int>& slot, int error, int priority) noexcept
+    {
+        int expected = 0;
+
+        if (slot.compare_exchange_strong (expected, error))
+        {
+            if (priority > 0)
+                getState().failedPriority.store (priority);
+
+            getState().failureCount.fetch_add (1);
+        }
+    }
+
+    juce::String describeError (int error)
+    {
+       #if JUCE_LINUX || JUCE_BSD
+        if (error == EPERM)
+            return "EPERM (not permitted: grant CAP_SYS_NICE or an rtprio limit in /etc/security/limits.conf)";
+
+        if (error == EINVAL)
+            return "EINVAL (invalid policy, priority or core)";
+       #endif
+
+        return "error " + juce::String (error) + " (" + juce::String (std::strerror (error)) + ")";
+    }
+}
+
+//==============================================================================
+void RealtimeScheduling::configure (const EngineSettings& settings)
+{
+    auto& state = getState();
+
+   #if JUCE_LINUX || JUCE_BSD
+    if (settings.rtPolicy == "fifo")     state.policy = SCHED_FIFO;
+    else if (settings.rtPolicy == "rr")  state.policy = SCHED_RR;
+   #endif
+
+    state.policyName = state.policy != 0 ? settings.rtPolicy : juce::String();
+    state.audioPriority = settings.rtAudioPriority;
+    state.workerPriority = settings.rtWorkerPriority;
+    state.audioCores = settings.audioCores;
+    state.uiCores = settings.uiCores;
+
+    // Without an explicit UI set, everything that isn't audio goes on the remaining cores.
+    if (state.uiCores.isEmpty() && ! state.audioCores.isEmpty())
+        for (int core = 0; core < juce::SystemStats::getNumCpus(); ++core)
+            if (! state.audioCores.contains (core))
+                state.uiCores.add (core);
+
+    if (auto error = setAffinity (state.uiCores))
+        recordFailure (state.affinityError, error, 0);
+
+    if (state.policy != 0 || ! state.audioCores.isEmpty())
+        juce::Logger::writeToLog ("Real-time scheduling: " + getSummary()
+                                  + (state.uiCores.isEmpty() ? juce::String() : ", UI cores " + describeCores (state.uiCores)));
+}
+
+void RealtimeScheduling::applyToCurrentThread (Role role, int preferredCore) noexcept
+{
+    auto& state = getState();
+    const int priority = role == Role::audio ? state.audioPriority : state.workerPriority;
+
+    if (auto error = setPriority (state.policy, priority))
+        recordFailure (state.priorityError, error, priority);
+
+    const int error = preferredCore >= 0 ? setAffinity (&preferredCore, 1)
+                                         : setAffinity (state.audioCores);
+
+    if (error != 0)
+        recordFailure (state.affinityError, error, 0);
+}
+
+juce::String RealtimeScheduling::takeReport()
+{
+    auto& state = getState();
+    const auto count = state.failureCount.load();
+
+    if (count == state.reportedCount)
+        return {};
+
+    state.reportedCount = count;
+    juce::StringArray problems;
+
+    if (auto error = state.priorityError.load())
+        problems.add ("SCHED_" + state.policyName.toUpperCase() + " priority " + juce::String (state.failedPriority.load())
+                      + " refused: " + describeError (error));
+
+    if (auto error = state.affinityError.load())
+        problems.add ("CPU affinity refused: " + describeError (error));
+
+    return problems.joinIntoString ("; ");
+}
+
+juce::String RealtimeScheduling::getSummary()
+{
+    auto& state = getState();
+    juce::StringArray parts;
+
+    if (state.policy != 0)
+        parts.add ("RT " + state.policyName + " " + juce::String (state.audioPriority) + "/" + juce::String (state.workerPriority)
+                   + (state.priorityError.load() != 0 ? " REFUSED" : ""));
+
+    if (! state.audioCores.isEmpty())
+        parts.add ("audio cores " + describeCores (state.audioCores)
+                   + (state.affinityError.load() != 0 ? " REFUSED" : ""));
+
+    return parts.joinIntoString (", ");
+}
+
+bool RealtimeScheduling::hasFailures() noexcept
+{
+    return getState().failureCount.load() != 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "EngineSettings.h"
+
+// Process-wide real-time scheduling and core isolation.
+//
+// configure() runs once on the message thread before any audio thread exists. It moves
+// the message thread (and so every thread it creates afterwards, which inherit its
+// mask) onto the UI cores. Audio threads then call applyToCurrentThread() when they
+// start, which puts them under SCHED_FIFO/SCHED_RR at the configured priority and onto
+// the audio cores. That call doesn't lock or allocate, so it is safe from inside a
+// device callback. Failures are recorded and picked up by takeReport() on the message
+// thread, because the threads that hit them can't log.
+//
+// Priorities and policies are only changed on Linux; affinity is applied everywhere JUCE
+// supports it.
+class RealtimeScheduling
+{
+public:
+    enum class Role { audio, worker };
+
+    // Message thread, at startup.
+    static void configure (const EngineSettings& settings);
+
+    // Any thread. preferredCore, if not -1, overrides the audio core set for this thread.
+    static void applyToCurrentThread (Role role, int preferredCore = -1) noexcept;
+
+    // Message thread. Returns a description of anything that went wrong since the last
+    // call, or an empty string.
+    static juce::String takeReport();
+
+    // Message thread. Short status, e.g. "RT fifo 80/75, audio cores 2,3".
+    static juce::String getSummary();
+
+    // True if the kernel refused a request (usually EPERM: no CAP_SYS_NICE and no rtprio
+    // limit for this user).
+    static bool hasFailures() noexcept;
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeScheduling.h"
+#include "MemoryResidency.h"
+#include <atomic>
+#include <type_traits>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+// Runs a fixed set of independent tasks in parallel from inside the audio callback.
+//
+// Tasks are split statically: task i always runs on thread i % numThreads, where thread
+// 0 is the caller itself. That keeps each plugin instance on the same core from block
+// to block, and means nothing is handed out through a shared counter. run() returns
+// only once every task has finished, so the caller can read all the outputs straight
+// away. Workers spin briefly for the next block before going to sleep.
+//
+// A worker that has gone to sleep, or that the scheduler doesn't get round to, must not
+// hold the block up indefinitely. So each slice is claimed before it runs, and once the
+// caller has waited an eighth of a block at the barrier it claims and runs whatever
+// nobody has started itself. At worst the block then takes as long as it would serially.
+//
+// run() may be entered again from inside one of its own tasks, or from two threads at
+// once: only one call at a time gets the workers, and any other runs its tasks one after
+// another on its own thread. So a pool can be shared by nested work, such as a hosted
+// chain's branches inside a pair's task, without more threads spinning for it.
+class RealtimeWorkerPool
+{
+public:
+    ~RealtimeWorkerPool()
+    {
+        stop();
+    }
+
+    // Message thread, while the audio callback is stopped. Worker i is pinned to cores[i]
+    // if there is one, and otherwise goes wherever the audio threads may run.
+    void start (int numWorkers, double sampleRate, int maxBlockSize, const juce::Array<int>& cores = {})
+    {
+        stop();
+
+        // One claim bit per slice, and slice 0 is the caller's.
+        numWorkers = juce::jmin (numWorkers, maxThreads - 1);
+        stealTicks = (juce::int64) ((double) juce::Time::getHighResolutionTicksPerSecond()
+                                     * (double) juce::jmax (1, maxBlockSize) / juce::jmax (1.0, sampleRate) / 8.0);
+
+        for (int i = 0; i < numWorkers; ++i)
+        {
+            auto* worker = workers.add (new Worker (*this, i + 1, i < cores.size() ? cores[i] : -1));
+
+            if (! worker->startRealtimeThread (juce::Thread::RealtimeOptions{}.withPriority (9)
+                                                                             .withApproximateAudioProcessingTime (maxBlockSize, sampleRate)))
+                worker->startThread (juce::Thread::Priority::highest);
+        }
+    }
+
+    void stop()
+    {
+        for (auto* worker : workers)
+            worker->signalThreadShouldExit();
+
+        for (auto* worker : workers)
+            worker->stopThread (2000);
+
+        workers.clear();
+    }
+
+    int getNumWorkers() const noexcept    { return workers.size(); }
+
+    // Audio thread. Calls task (index) once for every index in [0, numTasks) and returns
+    // when all of them are done, using at most maxWorkers of the workers (-1 = all).
+    template <typename TaskFn>
+    void run (int numTasks, TaskFn& task, int maxWorkers = -1) noexcept
+    {
+        const int available = maxWorkers >= 0 ? juce::jmin (maxWorkers, workers.size()) : workers.size();
+        const int numThreads = juce::jmin (numTasks, available + 1);
+
+        if (numThreads <= 1 || inUse.exchange (true, std::memory_order_acquire))
+        {
+            for (int i = 0; i < numTasks; ++i)
+                task (i);
+
+            return;
+        }
+
+        jobContext = &task;
+        jobInvoke = [] (void* context, int index) { (*static_cast<TaskFn*> (context)) (index); };
+        jobTasks = numTasks;
+        jobThreads = numThreads;
+        remaining.store (numThreads - 1, std::memory_order_relaxed);
+        unclaimed.store ((((juce::uint64) 1 << numThreads) - 1) & ~(juce::uint64) 1, std::memory_order_release);
+
+        const auto stealAt = juce::Time::getHighResolutionTicks() + stealTicks;
+
+        for (int i = 0; i < numThreads - 1; ++i)
+            workers.getUnchecked (i)->post();
+
+        runSlice (0);
+
+        // Barrier. Workers that were still spinning start at once, but one that had gone
+        // to sleep only starts when the scheduler wakes it, and one sharing a core with a
+        // busier thread may not start at all; past stealAt those slices run here. What is
+        // left after that is already running on a worker, so yield rather than spin.
+        bool stolen = false;
+
+        while (remaining.load (std::memory_order_acquire) > 0)
+        {
+            if (stolen)
+            {
+                juce::Thread::yield();
+            }
+            else if (juce::Time::getHighResolutionTicks() >= stealAt)
+            {
+                runUnclaimedSlices();
+                stolen = true;
+            }
+            else
+            {
+                pause();
+            }
+        }
+
+        inUse.store (false, std::memory_order_release);
+    }
+
+private:
+    class Worker  : public juce::Thread
+    {
+    public:
+        Worker (RealtimeWorkerPool& p, int slice, int cpuCore)
+            : juce::Thread ("RT worker " + juce::String (slice)), pool (p), sliceIndex (slice), core (cpuCore)
+        {
+        }
+
+        ~Worker() override
+        {
+            stopThread (2000);
+        }
+
+        void post() noexcept
+        {
+            requested.fetch_add (1, std::memory_order_release);
+            notify();
+        }
+
+    private:
+        void run() override
+        {
+            RealtimeScheduling::applyToCurrentThread (RealtimeScheduling::Role::worker, core);
+            MemoryResidency::prefaultStack();
+
+            juce::uint32 handled = requested.load();
+
+            while (! threadShouldExit())
+            {
+                if (requested.load (std::memory_order_acquire) == handled)
+                {
+                    // Spin through short gaps so back-to-back blocks don't pay for a wake-up.
+                    if (++idleSpins < spinLimit)
+                    {
+                        pause();
+                        continue;
+                    }
+
+                    idleSpins = 0;
+                    wait (-1);
+                    continue;
+                }
+
+                ++handled;
+                idleSpins = 0;
+
+                // A wake-up that arrives late finds its slice already run by the caller.
+                if (pool.claimSlice (sliceIndex))
+                {
+                    pool.runSlice (sliceIndex);
+                    pool.remaining.fetch_sub (1, std::memory_order_acq_rel);
+                }
+            }
+        }
+
+        static constexpr int spinLimit = 2000;
+
+        RealtimeWorkerPool& pool;
+        const int sliceIndex;
+        const int core;
+        std::atomic<juce::uint32> requested { 0 };
+        int idleSpins = 0;
+    };
+
+    void runSlice (int slice) noexcept
+    {
+        for (int i = slice; i < jobTasks; i += jobThreads)
+            jobInvoke (jobContext, i);
+    }
+
+    bool claimSlice (int slice) noexcept
+    {
+        const auto bit = (juce::uint64) 1 << slice;
+        return (unclaimed.fetch_and (~bit, std::memory_order_acq_rel) & bit) != 0;
+    }
+
+    void runUnclaimedSlices() noexcept
+    {
+        const auto left = unclaimed.exchange (0, std::memory_order_acq_rel);
+
+        for (int slice = 1; slice < jobThreads; ++slice)
+        {
+            if ((left & ((juce::uint64) 1 << slice)) != 0)
+            {
+                runSlice (slice);
+                remaining.fetch_sub (1, std::memory_order_acq_rel);
+            }
+        }
+    }
+
+    // Tells the core this is a spin-wait, so it backs off instead of hammering the cache
+    // line and starving a sibling hyperthread.
+    static void pause() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+
+    static constexpr int maxThreads = 64;
+
+    juce::OwnedArray<Worker> workers;
+
+    // Written by the audio thread before any worker is posted, read-only while they run.
+    void* jobContext = nullptr;
+    void (*jobInvoke) (void*, int) = nullptr;
+    int jobTasks = 0;
+    int jobThreads = 1;
+    juce::int64 stealTicks = 0;
+    std::atomic<int> remaining { 0 };
+    std::atomic<juce::uint64> unclaimed { 0 };     // bit i: slice i not yet started by anyone
+    std::atomic<bool> inUse { false };              // a run() has the workers
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioFifo.h"
+#include <atomic>
+#include <numeric>
+
+// Feeds the plugin a fixed block size whatever period the device runs at. Input is
+// queued until a full block is available, rendered, and queued again on the way out;
+// the output side is primed with just enough silence that a device period never has to
+// wait for the next full block.
+class Reblocker
+{
+public:
+    // Message thread, while the audio callback is stopped. A block size of 0 disables
+    // re-blocking.
+    void prepare (int numChannels, int fixedBlockSize, int deviceBlockSize)
+    {
+        blockSize = juce::jmax (0, fixedBlockSize);
+        underruns.store (0);
+
+        if (blockSize == 0)
+        {
+            latencySamples = 0;
+            return;
+        }
+
+        // With a steady device period n, the shortfall at any callback is at most
+        // blockSize - gcd (n, blockSize), so that is all the priming we need. When the
+        // device period is a multiple of the block size this is zero.
+        const int period = juce::jmax (1, deviceBlockSize);
+        latencySamples = blockSize - std::gcd (period, blockSize);
+
+        const int capacity = 2 * (blockSize + period);
+        input.setSize (numChannels, capacity);
+        output.setSize (numChannels, capacity + latencySamples);
+        work.setSize (numChannels, blockSize, false, true, false);
+        MemoryResidency::prefault (work);
+
+        output.pushSilence (latencySamples);
+    }
+
+    bool isActive() const noexcept           { return blockSize > 0; }
+    int getBlockSize() const noexcept        { return blockSize; }
+    int getLatencySamples() const noexcept   { return latencySamples; }
+    int getUnderrunCount() const noexcept    { return underruns.load(); }
+
+    // Render thread. renderFixedBlock is called zero or more times, always with exactly
+    // getBlockSize() samples.
+    template <typename RenderFn>
+    void process (juce::AudioBuffer<float>& buffer, RenderFn&& renderFixedBlock) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+        input.push (buffer, 0, numSamples);
+
+        while (input.getNumReady() >= blockSize && output.getFreeSpace() >= blockSize)
+        {
+            juce::AudioBuffer<float> block (work.getArrayOfWritePointers(), work.getNumChannels(), blockSize);
+            input.pull (block, 0, blockSize);
+            renderFixedBlock (block);
+            output.push (block, 0, blockSize);
+        }
+
+        const int numRead = output.pull (buffer, 0, numSamples);
+
+        // Only happens if the device period changes under us.
+        if (numRead < numSamples)
+        {
+            buffer.clear (numRead, numSamples - numRead);
+            underruns.fetch_add (1);
+        }
+    }
+
+private:
+    int blockSize = 0;
+    int latencySamples = 0;
+    AudioFifo input, output;
+    juce::AudioBuffer<float> work;
+    std::atomic<int> underruns { 0 };
+};
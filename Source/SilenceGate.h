@@ -0,0 +1,109 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cmath>
+
+// Decides when the plugin can stop being called because nothing would come out of it.
+//
+// The gate closes once the input has stayed below the threshold for the hold time and
+// for the plugin's declared tail, and the plugin's own output has also stayed below the
+// threshold for the hold time (declared tails are often wrong, infinite or zero). It
+// opens again on the very first block with any input above the threshold, and that
+// block is processed normally, so nothing is lost on resume.
+class SilenceGate
+{
+public:
+    // Message thread, while the audio callback is stopped. A hold time of 0 disables
+    // the gate.
+    void prepare (double sampleRate, int thresholdDb, int holdMs)
+    {
+        threshold = juce::Decibels::decibelsToGain ((float) thresholdDb);
+        holdSamples = (juce::int64) (sampleRate * holdMs / 1000.0);
+        maxTailSamples = (juce::int64) (sampleRate * maxTailSeconds);
+        rate = sampleRate;
+        inputSilentSamples = 0;
+        outputSilentSamples = 0;
+        idle.store (false);
+    }
+
+    bool isEnabled() const noexcept    { return holdSamples > 0; }
+
+    // Any thread.
+    bool isIdle() const noexcept       { return idle.load(); }
+
+    // Render thread, before the block is processed. Returns true if the plugin needs
+    // to run. getTailSeconds is only asked once the input has gone quiet.
+    template <typename TailFn>
+    bool beginBlock (const juce::AudioBuffer<float>& input, TailFn&& getTailSeconds) noexcept
+    {
+        if (! isEnabled())
+            return true;
+
+        const int numSamples = input.getNumSamples();
+
+        if (getPeak (input) > threshold)
+        {
+            inputSilentSamples = 0;
+            outputSilentSamples = 0;
+            idle.store (false);
+            return true;
+        }
+
+        inputSilentSamples += numSamples;
+
+        if (idle.load())
+            return false;
+
+        if (inputSilentSamples >= holdSamples && outputSilentSamples >= holdSamples)
+        {
+            const double tail = getTailSeconds();
+            const auto tailSamples = std::isfinite (tail) ? juce::jlimit ((juce::int64) 0, maxTailSamples, (juce::int64) (tail * rate))
+                                                          : maxTailSamples;
+
+            if (inputSilentSamples >= holdSamples + tailSamples)
+            {
+                idle.store (true);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Render thread, after a block beginBlock() let through has been processed.
+    void endBlock (const juce::AudioBuffer<float>& output) noexcept
+    {
+        if (! isEnabled())
+            return;
+
+        if (getPeak (output) > threshold)
+            outputSilentSamples = 0;
+        else
+            outputSilentSamples += output.getNumSamples();
+    }
+
+private:
+    static float getPeak (const juce::AudioBuffer<float>& buffer) noexcept
+    {
+        float peak = 0.0f;
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            peak = juce::jmax (peak, buffer.getMagnitude (ch, 0, buffer.getNumSamples()));
+
+        return peak;
+    }
+
+    // Plugins that report an infinite or absurd tail still get to idle eventually, as
+    // long as their output really is silent.
+    static constexpr double maxTailSeconds = 30.0;
+
+    float threshold = 0.0f;
+    juce::int64 holdSamples = 0;
+    juce::int64 maxTailSamples = 0;
+    double rate = 44100.0;
+
+    juce::int64 inputSilentSamples = 0;
+    juce::int64 outputSilentSamples = 0;
+    std::atomic<bool> idle { false };
+};
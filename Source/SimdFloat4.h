@@ -0,0 +1,223 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cmath>
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define STARNAILS_FLOAT4_SSE2 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+ #include <arm_neon.h>
+ #define STARNAILS_FLOAT4_NEON 1
+#endif
+
+// Four floats processed together: SSE2 or NEON where available, plain arrays otherwise.
+// Just the handful of operations the native DSP kernels need, so their inner loops read
+// like scalar code while running four lanes (channels, bands or filter stages) at once.
+struct Float4
+{
+   #if STARNAILS_FLOAT4_SSE2
+    __m128 v;
+
+    Float4() noexcept : v (_mm_setzero_ps()) {}
+    Float4 (__m128 x) noexcept : v (x) {}
+    explicit Float4 (float x) noexcept : v (_mm_set1_ps (x)) {}
+    Float4 (float a, float b, float c, float d) noexcept : v (_mm_setr_ps (a, b, c, d)) {}
+
+    static Float4 load (const float* p) noexcept         { return _mm_loadu_ps (p); }
+    void store (float* p) const noexcept                 { _mm_storeu_ps (p, v); }
+
+    friend Float4 operator+ (Float4 a, Float4 b) noexcept { return _mm_add_ps (a.v, b.v); }
+    friend Float4 operator- (Float4 a, Float4 b) noexcept { return _mm_sub_ps (a.v, b.v); }
+    friend Float4 operator* (Float4 a, Float4 b) noexcept { return _mm_mul_ps (a.v, b.v); }
+
+    static Float4 max (Float4 a, Float4 b) noexcept      { return _mm_max_ps (a.v, b.v); }
+    static Float4 abs (Float4 a) noexcept                { return _mm_andnot_ps (_mm_set1_ps (-0.0f), a.v); }
+
+    // a > b ? ifGreater : otherwise, per lane.
+    static Float4 selectGreater (Float4 a, Float4 b, Float4 ifGreater, Float4 otherwise) noexcept
+    {
+        const __m128 mask = _mm_cmpgt_ps (a.v, b.v);
+        return _mm_or_ps (_mm_and_ps (mask, ifGreater.v), _mm_andnot_ps (mask, otherwise.v));
+    }
+   #elif STARNAILS_FLOAT4_NEON
+    float32x4_t v;
+
+    Float4() noexcept : v (vdupq_n_f32 (0.0f)) {}
+    Float4 (float32x4_t x) noexcept : v (x) {}
+    explicit Float4 (float x) noexcept : v (vdupq_n_f32 (x)) {}
+    Float4 (float a, float b, float c, float d) noexcept { const float lanes[4] { a, b, c, d }; v = vld1q_f32 (lanes); }
+
+    static Float4 load (const float* p) noexcept         { return vld1q_f32 (p); }
+    void store (float* p) const noexcept                 { vst1q_f32 (p, v); }
+
+    friend Float4 operator+ (Float4 a, Float4 b) noexcept { return vaddq_f32 (a.v, b.v); }
+    friend Float4 operator- (Float4 a, Float4 b) noexcept { return vsubq_f32 (a.v, b.v); }
+    friend Float4 operator* (Float4 a, Float4 b) noexcept { return vmulq_f32 (a.v, b.v); }
+
+    static Float4 max (Float4 a, Float4 b) noexcept      { return vmaxq_f32 (a.v, b.v); }
+    static Float4 abs (Float4 a) noexcept                { return vabsq_f32 (a.v); }
+
+    static Float4 selectGreater (Float4 a, Float4 b, Float4 ifGreater, Float4 otherwise) noexcept
+    {
+        return vbslq_f32 (vcgtq_f32 (a.v, b.v), ifGreater.v, otherwise.v);
+    }
+   #else
+    float v[4];
+
+    Float4() noexcept : v { 0.0f, 0.0f, 0.0f, 0.0f } {}
+    explicit Float4 (float x) noexcept : v { x, x, x, x } {}
+    Float4 (float a, float b, float c, float d) noexcept : v { a, b, c, d } {}
+
+    static Float4 load (const float* p) noexcept         { return { p[0], p[1], p[2], p[3] }; }
+    void store (float* p) const noexcept                 { for (int i = 0; i < 4; ++i) p[i] = v[i]; }
+
+    friend Float4 operator+ (Float4 a, Float4 b) noexcept { return { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] }; }
+    friend Float4 operator- (Float4 a, Float4 b) noexcept { return { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] }; }
+    friend Float4 operator* (Float4 a, Float4 b) noexcept { return { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] }; }
+
+    static Float4 max (Float4 a, Float4 b) noexcept
+    {
+        return { juce::jmax (a.v[0], b.v[0]), juce::jmax (a.v[1], b.v[1]), juce::jmax (a.v[2], b.v[2]), juce::jmax (a.v[3], b.v[3]) };
+    }
+
+    static Float4 abs (Float4 a) noexcept                { return { std::abs (a.v[0]), std::abs (a.v[1]), std::abs (a.v[2]), std::abs (a.v[3]) }; }
+
+    static Float4 selectGreater (Float4 a, Float4 b, Float4 ifGreater, Float4 otherwise) noexcept
+    {
+        Float4 r;
+
+        for (int i = 0; i < 4; ++i)
+            r.v[i] = a.v[i] > b.v[i] ? ifGreater.v[i] : otherwise.v[i];
+
+        return r;
+    }
+   #endif
+
+    Float4& operator+= (Float4 b) noexcept               { return *this = *this + b; }
+    Float4& operator*= (Float4 b) noexcept               { return *this = *this * b; }
+
+    float get (int lane) const noexcept
+    {
+        float lanes[4];
+        store (lanes);
+        return lanes[lane];
+    }
+};
+
+// Four independent biquads in transposed direct form II, one per lane, each with its
+// own coefficients.
+struct Biquad4
+{
+    struct Coefficients
+    {
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+    };
+
+    enum class Shape { lowPass, highPass, allPass, peak };
+
+    // RBJ cookbook designs.
+    static Coefficients design (Shape shape, double sampleRate, double frequency, double q, double gainDb = 0.0)
+    {
+        const double w0 = juce::MathConstants<double>::twoPi * juce::jlimit (1.0, sampleRate * 0.49, frequency) / sampleRate;
+        const double cosw = std::cos (w0);
+        const double alpha = std::sin (w0) / (2.0 * juce::jmax (0.01, q));
+        const double A = std::pow (10.0, gainDb / 40.0);
+
+        double b0, b1, b2, a0, a1, a2;
+
+        switch (shape)
+        {
+            case Shape::lowPass:   b0 = (1.0 - cosw) / 2.0; b1 = 1.0 - cosw; b2 = b0; a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha; break;
+            case Shape::highPass:  b0 = (1.0 + cosw) / 2.0; b1 = -(1.0 + cosw); b2 = b0; a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha; break;
+            case Shape::allPass:   b0 = 1.0 - alpha; b1 = -2.0 * cosw; b2 = 1.0 + alpha; a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha; break;
+            case Shape::peak:
+            default:               b0 = 1.0 + alpha * A; b1 = -2.0 * cosw; b2 = 1.0 - alpha * A; a0 = 1.0 + alpha / A; a1 = -2.0 * cosw; a2 = 1.0 - alpha / A; break;
+        }
+
+        return { (float) (b0 / a0), (float) (b1 / a0), (float) (b2 / a0), (float) (a1 / a0), (float) (a2 / a0) };
+    }
+
+    void setLane (int lane, const Coefficients& c) noexcept
+    {
+        b0[lane] = c.b0; b1[lane] = c.b1; b2[lane] = c.b2; a1[lane] = c.a1; a2[lane] = c.a2;
+    }
+
+    void reset() noexcept                 { s1 = s2 = Float4(); }
+
+    Float4 process (Float4 x) noexcept
+    {
+        const Float4 y = Float4::load (b0) * x + s1;
+        s1 = Float4::load (b1) * x - Float4::load (a1) * y + s2;
+        s2 = Float4::load (b2) * x - Float4::load (a2) * y;
+        return y;
+    }
+
+private:
+    float b0[4] { 1.0f, 1.0f, 1.0f, 1.0f }, b1[4] {}, b2[4] {}, a1[4] {}, a2[4] {};
+    Float4 s1, s2;
+};
+
+// Broadband phase rotation, one angle per lane. Two chains of second-order allpass
+// sections (Niemitalo's polyphase Hilbert pair) give outputs that stay 90 degrees apart
+// over nearly the whole band, and the output is cos(angle) * one + sin(angle) * other.
+// Both chains are allpass, so the magnitude stays flat whatever the angle (within a
+// few hundredths of a dB from 20 Hz up at 44.1 kHz); only the waveform's shape changes.
+// Like any phase rotator it is dispersive: lows come out later than highs.
+struct PhaseRotator4
+{
+    void setAngle (int lane, float radians) noexcept
+    {
+        cosine[lane] = std::cos (radians);
+        sine[lane] = std::sin (radians);
+    }
+
+    void reset() noexcept
+    {
+        for (auto* chain : { first, second })
+            for (int i = 0; i < numSections; ++i)
+                chain[i] = Section { chain[i].coefficient };
+
+        firstDelayed = Float4();
+    }
+
+    Float4 process (Float4 x) noexcept
+    {
+        Float4 a = x, b = x;
+
+        for (int i = 0; i < numSections; ++i)
+        {
+            a = first[i].process (a);
+            b = second[i].process (b);
+        }
+
+        // The first chain lines up with the second one sample later.
+        const Float4 inPhase = firstDelayed;
+        firstDelayed = a;
+        return Float4::load (cosine) * inPhase + Float4::load (sine) * b;
+    }
+
+private:
+    // y[n] = c * (x[n] + y[n-2]) - x[n-2], with c the square of the published coefficient.
+    struct Section
+    {
+        Float4 coefficient, x1, x2, y1, y2;
+
+        Float4 process (Float4 x) noexcept
+        {
+            const Float4 y = coefficient * (x + y2) - x2;
+            x2 = x1; x1 = x;
+            y2 = y1; y1 = y;
+            return y;
+        }
+    };
+
+    static constexpr int numSections = 4;
+
+    Section first[numSections]  { { Float4 (0.6923878f * 0.6923878f) },       { Float4 (0.9360654322959f * 0.9360654322959f) },
+                                  { Float4 (0.9882295226860f * 0.9882295226860f) }, { Float4 (0.9987488452737f * 0.9987488452737f) } };
+    Section second[numSections] { { Float4 (0.4021921162426f * 0.4021921162426f) }, { Float4 (0.8561710882420f * 0.8561710882420f) },
+                                  { Float4 (0.9722909545651f * 0.9722909545651f) }, { Float4 (0.9952884791278f * 0.9952884791278f) } };
+    Float4 firstDelayed;
+    float cosine[4] { 1.0f, 1.0f, 1.0f, 1.0f }, sine[4] {};
+};
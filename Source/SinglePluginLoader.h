@@ -1,76 +1,428 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "MemoryResidency.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <vector>
 
-class SinglePluginLoader
+// Loads plugins on a dedicated loader thread so neither the UI nor the device start has
+// to wait for a plugin to scan, construct and prepare. Progress and elapsed time can be
+// polled from the message thread while a load runs, a load can be cancelled between
+// stages, and the finished, prepared instance is delivered back on the message thread.
+//
+// Note that JUCE marshals the plugin constructor itself onto the message thread for
+// formats that need it (VST2 does), so the loader thread covers module scanning and
+// preparation while the message thread is only held for the constructor call. The same
+// goes for destructors, so the loader thread never destroys an instance: anything a
+// cancelled, failed or superseded load created travels back in its Result and dies on
+// the message thread.
+class SinglePluginLoader : private juce::Thread
 {
 public:
-    SinglePluginLoader()
+    enum class Stage { idle, scanning, instantiating, preparing };
+
+    struct Result
     {
+        std::unique_ptr<juce::AudioPluginInstance> instance;
+        std::vector<std::unique_ptr<juce::AudioPluginInstance>> siblings;   // further copies, when more than one was asked for
+        std::vector<std::vector<std::unique_ptr<juce::AudioPluginInstance>>> members;  // loadAllAsync: each file's instances, in order
+        std::vector<std::unique_ptr<juce::AudioPluginInstance>> discarded; // created but not delivered; destroyed with the Result
+        juce::File file;
+        juce::String errorMessage;
+        bool cancelled = false;
+
+        // The settings the instance was prepared with.
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        juce::String layout;
+
+        double scanMs = 0.0;
+        double instantiateMs = 0.0;
+        double prepareMs = 0.0;
+
+        double getTotalMs() const noexcept { return scanMs + instantiateMs + prepareMs; }
+    };
+
+    using Completion = std::function<void (Result&)>;
+
+    // Sets up a new instance's buses before it is prepared, and describes what it got.
+    using LayoutFunction = std::function<juce::String (juce::AudioPluginInstance&)>;
+
+    SinglePluginLoader() : juce::Thread ("Plugin loader")
+    {
+        ensureFormats();
+        startThread();
     }
 
-    ~SinglePluginLoader()
+    ~SinglePluginLoader() override
     {
-        unload();
+        cancel();
+
+        // If a constructor is still waiting on the message thread we cannot wait for it
+        // here (we are on the message thread), so give up after a bounded time. Whatever
+        // the load had created is posted back to the message thread and destroyed there.
+        stopThread (4000);
     }
 
-    bool load (const juce::File& pluginFile, double sampleRate, int blockSize, juce::String& errorMessage)
+    //==============================================================================
+    // Message thread. Tries each file in order and delivers the first that loads, as
+    // numInstances independent, prepared instances. applyLayout runs on the loader thread.
+    // A new request supersedes one still in flight; the superseded one is dropped without
+    // a callback.
+    void loadAsync (juce::Array<juce::File> candidates, double sampleRate, int blockSize,
+                    LayoutFunction applyLayout, int numInstances, Completion onComplete)
     {
-        unload();
-        ensureFormats();
+        {
+            const juce::ScopedLock sl (requestLock);
+            nextRequest = std::make_unique<Request> (Request { std::move (candidates), sampleRate, blockSize,
+                                                               std::move (applyLayout), juce::jmax (1, numInstances),
+                                                               std::move (onComplete), ++requestGeneration });
+        }
 
-        if (! pluginFile.existsAsFile())
+        notify();
+    }
+
+    // Message thread. Loads every file rather than the first that works, for hosting them
+    // together: Result::members gets numInstances instances of each, in the files' order,
+    // and Result::instance stays empty. If any file fails, the whole load fails.
+    void loadAllAsync (juce::Array<juce::File> files, double sampleRate, int blockSize,
+                       LayoutFunction applyLayout, int numInstances, Completion onComplete)
+    {
         {
-            errorMessage = "Plugin file does not exist: " + pluginFile.getFullPathName();
-            return false;
+            const juce::ScopedLock sl (requestLock);
+            nextRequest = std::make_unique<Request> (Request { std::move (files), sampleRate, blockSize,
+                                                               std::move (applyLayout), juce::jmax (1, numInstances),
+                                                               std::move (onComplete), ++requestGeneration, true });
         }
 
-        std::unique_ptr<juce::PluginDescription> description;
-        juce::AudioPluginFormat* owningFormat = nullptr;
+        notify();
+    }
 
-        for (int i = 0; i < formatManager.getNumFormats(); ++i)
+    // Message thread. The in-flight load stops at its next stage boundary and completes
+    // with Result::cancelled set.
+    void cancel() noexcept
+    {
+        cancelledGeneration.store (requestGeneration.load());
+    }
+
+    bool isLoading() const noexcept              { return busy.load(); }
+    Stage getStage() const noexcept              { return stage.load(); }
+    float getProgress() const noexcept           { return progress.load(); }
+
+    double getElapsedSeconds() const noexcept
+    {
+        return busy.load() ? juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - loadStartTicks.load())
+                           : 0.0;
+    }
+
+    static juce::String getStageName (Stage s)
+    {
+        switch (s)
         {
-            auto* format = formatManager.getFormat (i);
-            juce::OwnedArray<juce::PluginDescription> types;
-            format->findAllTypesForFile (types, pluginFile.getFullPathName());
+            case Stage::scanning:       return "Scanning";
+            case Stage::instantiating:  return "Constructing";
+            case Stage::preparing:      return "Preparing";
+            case Stage::idle:           break;
+        }
 
-            if (! types.isEmpty())
+        return {};
+    }
+
+private:
+    struct Request
+    {
+        juce::Array<juce::File> candidates;
+        double sampleRate;
+        int blockSize;
+        LayoutFunction applyLayout;
+        int numInstances;
+        Completion onComplete;
+        juce::uint32 generation;
+        bool loadAll = false;
+    };
+
+    struct CachedDescription
+    {
+        juce::Time fileTime;
+        juce::PluginDescription description;
+    };
+
+    //==============================================================================
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            std::unique_ptr<Request> request;
+
+            {
+                const juce::ScopedLock sl (requestLock);
+                request = std::move (nextRequest);
+            }
+
+            if (request == nullptr)
+            {
+                wait (-1);
+                continue;
+            }
+
+            loadStartTicks.store (juce::Time::getHighResolutionTicks());
+            busy.store (true);
+
+            auto result = std::make_shared<Result>();
+            if (request->loadAll)
+                loadAll (*request, *result);
+            else
+                loadCandidates (*request, *result);
+
+            stage.store (Stage::idle);
+            progress.store (result->instance != nullptr || ! result->members.empty() ? 1.0f : 0.0f);
+            busy.store (false);
+
+            // Superseded requests are dropped without a callback, but their instances still
+            // go to the message thread to be destroyed.
+            if (request->generation != requestGeneration.load())
+            {
+                juce::MessageManager::callAsync ([result = std::move (result)] {});
+                continue;
+            }
+
+            // Moved, not copied, so the last reference is always the message thread's.
+            juce::MessageManager::callAsync ([result = std::move (result), onComplete = std::move (request->onComplete)]
+            {
+                if (onComplete != nullptr)
+                    onComplete (*result);
+            });
+        }
+    }
+
+    bool isStale (juce::uint32 generation) const noexcept
+    {
+        return threadShouldExit()
+            || generation != requestGeneration.load()
+            || generation <= cancelledGeneration.load();
+    }
+
+    void setStage (Stage newStage, float newProgress) noexcept
+    {
+        stage.store (newStage);
+        progress.store (newProgress);
+    }
+
+    void loadCandidates (const Request& request, Result& result)
+    {
+        result.sampleRate = request.sampleRate;
+        result.blockSize = request.blockSize;
+
+        const int numCandidates = request.candidates.size();
+
+        for (int i = 0; i < numCandidates; ++i)
+        {
+            const auto& file = request.candidates.getReference (i);
+
+            if (! file.existsAsFile())
+                continue;
+
+            result.file = file;
+            result.errorMessage = {};
+            result.instance = loadFile (request, file, result,
+                                        (float) i / (float) numCandidates, 1.0f / (float) numCandidates);
+
+            if (result.instance != nullptr)
             {
-                description.reset (types.removeAndReturn (0));
-                owningFormat = format;
+                // The instances are prepared, so their code and heap are mapped now.
+                const auto startTicks = juce::Time::getHighResolutionTicks();
+                MemoryResidency::touchModule (file);
+                MemoryResidency::refresh();
+                result.prepareMs += 1000.0 * juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+                return;
+            }
+
+            if (result.cancelled)
+                return;
+        }
+
+        if (result.errorMessage.isEmpty())
+            result.errorMessage = numCandidates == 1 ? "Plugin file does not exist: " + request.candidates[0].getFullPathName()
+                                                     : juce::String ("No plugin file found.");
+    }
+
+    void loadAll (const Request& request, Result& result)
+    {
+        result.sampleRate = request.sampleRate;
+        result.blockSize = request.blockSize;
+
+        const int numFiles = request.candidates.size();
+
+        for (int i = 0; i < numFiles; ++i)
+        {
+            const auto& file = request.candidates.getReference (i);
+
+            if (! file.existsAsFile())
+            {
+                result.errorMessage = "Plugin file does not exist: " + file.getFullPathName();
+                break;
+            }
+
+            auto first = loadFile (request, file, result, (float) i / (float) numFiles, 1.0f / (float) numFiles);
+
+            if (first == nullptr)
+            {
+                if (! result.cancelled)
+                    result.errorMessage = file.getFileName() + ": " + result.errorMessage;
+
                 break;
             }
+
+            result.members.emplace_back();
+            result.members.back().push_back (std::move (first));
+
+            for (auto& sibling : result.siblings)
+                result.members.back().push_back (std::move (sibling));
+
+            result.siblings.clear();
         }
 
-        if (description == nullptr || owningFormat == nullptr)
+        if ((int) result.members.size() != numFiles)
         {
-            errorMessage = "No compatible plugin format for file: " + pluginFile.getFullPathName();
-            return false;
+            for (auto& member : result.members)
+                discard (result, member);
+
+            result.members.clear();
+            return;
         }
 
-        pluginInstance = owningFormat->createInstanceFromDescription (*description, sampleRate, blockSize, errorMessage);
+        const auto startTicks = juce::Time::getHighResolutionTicks();
 
-        if (pluginInstance == nullptr)
+        for (auto& file : request.candidates)
+            MemoryResidency::touchModule (file);
+
+        MemoryResidency::refresh();
+        result.prepareMs += 1000.0 * juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    std::unique_ptr<juce::AudioPluginInstance> loadFile (const Request& request, const juce::File& file,
+                                                         Result& result, float progressBase, float progressSpan)
+    {
+        auto elapsedMsSince = [] (juce::int64 startTicks)
         {
-            if (errorMessage.isEmpty())
-                errorMessage = "Failed to create plugin instance.";
+            return 1000.0 * juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+        };
 
-            return false;
+        setStage (Stage::scanning, progressBase);
+        auto startTicks = juce::Time::getHighResolutionTicks();
+        auto description = findDescription (file, result.errorMessage);
+        result.scanMs += elapsedMsSince (startTicks);
+
+        if (description == nullptr)
+            return {};
+
+        if (isStale (request.generation))
+        {
+            result.cancelled = true;
+            return {};
         }
 
-        errorMessage = {};
-        return true;
+        std::unique_ptr<juce::AudioPluginInstance> first;
+        discard (result, result.siblings);
+
+        // Everything this file has produced so far, on the way out of a failed load.
+        auto abandon = [&] (std::unique_ptr<juce::AudioPluginInstance> instance)
+        {
+            discard (result, result.siblings);
+
+            for (auto* p : { &first, &instance })
+                if (*p != nullptr)
+                    result.discarded.push_back (std::move (*p));
+        };
+
+        for (int i = 0; i < request.numInstances; ++i)
+        {
+            const float instanceSpan = progressSpan * 0.8f / (float) request.numInstances;
+            const float instanceBase = progressBase + progressSpan * 0.2f + instanceSpan * (float) i;
+
+            setStage (Stage::instantiating, instanceBase);
+            startTicks = juce::Time::getHighResolutionTicks();
+            auto instance = formatManager.createPluginInstance (*description, request.sampleRate,
+                                                                request.blockSize, result.errorMessage);
+            result.instantiateMs += elapsedMsSince (startTicks);
+
+            if (instance == nullptr)
+            {
+                if (result.errorMessage.isEmpty())
+                    result.errorMessage = "Failed to create plugin instance.";
+
+                abandon (nullptr);
+                return {};
+            }
+
+            if (isStale (request.generation))
+            {
+                result.cancelled = true;
+                abandon (std::move (instance));
+                return {};
+            }
+
+            setStage (Stage::preparing, instanceBase + instanceSpan * 0.5f);
+            startTicks = juce::Time::getHighResolutionTicks();
+            result.layout = request.applyLayout (*instance);
+            instance->setRateAndBufferSizeDetails (request.sampleRate, request.blockSize);
+            instance->prepareToPlay (request.sampleRate, request.blockSize);
+            result.prepareMs += elapsedMsSince (startTicks);
+
+            if (isStale (request.generation))
+            {
+                result.cancelled = true;
+                abandon (std::move (instance));
+                return {};
+            }
+
+            if (first == nullptr)
+                first = std::move (instance);
+            else
+                result.siblings.push_back (std::move (instance));
+        }
+
+        return first;
     }
 
-    void unload()
+    static void discard (Result& result, std::vector<std::unique_ptr<juce::AudioPluginInstance>>& instances)
     {
-        pluginInstance.reset();
+        for (auto& instance : instances)
+            result.discarded.push_back (std::move (instance));
+
+        instances.clear();
     }
 
-    juce::AudioPluginInstance* get() const noexcept { return pluginInstance.get(); }
-    bool isLoaded() const noexcept { return pluginInstance != nullptr; }
+    // Loader thread only. Scanning a VST2 file instantiates the plugin once just to
+    // describe it, so remember the answer for as long as the file is unchanged.
+    std::unique_ptr<juce::PluginDescription> findDescription (const juce::File& pluginFile, juce::String& errorMessage)
+    {
+        const auto key = pluginFile.getFullPathName();
+        const auto fileTime = pluginFile.getLastModificationTime();
+
+        if (auto it = descriptionCache.find (key); it != descriptionCache.end() && it->second.fileTime == fileTime)
+            return std::make_unique<juce::PluginDescription> (it->second.description);
+
+        for (int i = 0; i < formatManager.getNumFormats(); ++i)
+        {
+            auto* format = formatManager.getFormat (i);
+            juce::OwnedArray<juce::PluginDescription> types;
+            format->findAllTypesForFile (types, key);
+
+            if (! types.isEmpty())
+            {
+                std::unique_ptr<juce::PluginDescription> description (types.removeAndReturn (0));
+                descriptionCache[key] = { fileTime, *description };
+                return description;
+            }
+        }
+
+        errorMessage = "No compatible plugin format for file: " + key;
+        return {};
+    }
 
-private:
     void ensureFormats()
     {
         if (formatsInitialised)
@@ -87,6 +439,18 @@ private:
     }
 
     juce::AudioPluginFormatManager formatManager;
-    std::unique_ptr<juce::AudioPluginInstance> pluginInstance;
     bool formatsInitialised { false };
+    std::map<juce::String, CachedDescription> descriptionCache;
+
+    juce::CriticalSection requestLock;
+    std::unique_ptr<Request> nextRequest;
+    std::atomic<juce::uint32> requestGeneration { 0 };
+    std::atomic<juce::uint32> cancelledGeneration { 0 };
+
+    std::atomic<bool> busy { false };
+    std::atomic<Stage> stage { Stage::idle };
+    std::atomic<float> progress { 0.0f };
+    std::atomic<juce::int64> loadStartTicks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SinglePluginLoader)
 };
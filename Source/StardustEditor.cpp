@@ -1,7 +1,8 @@
 #include "StardustEditor.h"
 
 //==============================================================================
-StardustEditor::ParameterControl::ParameterControl (juce::AudioProcessorParameter& p, const juce::String& labelOverride) : param (p)
+StardustEditor::ParameterControl::ParameterControl (StardustEditor& o, juce::AudioProcessorParameter& p, const juce::String& labelOverride)
+    : owner (o), param (p)
 {
     addAndMakeVisible (slider);
     addAndMakeVisible (nameLabel);
@@ -25,12 +26,30 @@ StardustEditor::ParameterControl::ParameterControl (juce::AudioProcessorParamete
     // We use the normalized value for the slider, but display the formatted text
     slider.onValueChange = [this]
     {
-        if (slider.isMouseButtonDown())
+        if (! slider.isMouseButtonDown())
+            return;
+
+        if (owner.onParameterChange != nullptr)
+            owner.onParameterChange (param, (float) slider.getValue());
+        else
             param.setValueNotifyingHost ((float) slider.getValue());
     };
 
-    slider.onDragStart = [this] { param.beginChangeGesture(); };
-    slider.onDragEnd   = [this] { param.endChangeGesture(); };
+    slider.onDragStart = [this]
+    {
+        if (owner.onParameterGesture != nullptr)
+            owner.onParameterGesture (param, true);
+        else
+            param.beginChangeGesture();
+    };
+
+    slider.onDragEnd = [this]
+    {
+        if (owner.onParameterGesture != nullptr)
+            owner.onParameterGesture (param, false);
+        else
+            param.endChangeGesture();
+    };
 
     // Configure Labels
     nameLabel.setText (labelOverride.isNotEmpty() ? labelOverride : param.getName (128), juce::dontSendNotification);
@@ -64,7 +83,11 @@ void StardustEditor::ParameterControl::resized()
 
 void StardustEditor::ParameterControl::syncFromParam()
 {
-    slider.setValue (param.getValue(), juce::dontSendNotification);
+    // While dragging, the parameter trails the slider until the audio thread applies
+    // the change, so don't pull the thumb back.
+    if (! slider.isMouseButtonDown())
+        slider.setValue (param.getValue(), juce::dontSendNotification);
+
     valueLabel.setText (param.getCurrentValueAsText(), juce::dontSendNotification);
 }
 
@@ -182,6 +205,12 @@ StardustEditor::~StardustEditor()
 
 void StardustEditor::setProcessor (juce::AudioProcessor* newProcessor)
 {
+    // Drop the old controls right away: they hold references into the previous
+    // processor's parameters, and that processor may be destroyed before the async
+    // rebuild runs.
+    rootGroup.reset();
+    allControls.clear();
+
     processor = newProcessor;
     triggerAsyncUpdate();
 }
@@ -273,7 +302,7 @@ void StardustEditor::createControlsForGroup (const juce::AudioProcessorParameter
     {
         if (auto* param = node->getParameter())
         {
-            auto ctrl = std::make_unique<ParameterControl> (*param);
+            auto ctrl = std::make_unique<ParameterControl> (*this, *param);
             comp.addAndMakeVisible (ctrl.get());
             allControls.push_back (ctrl.get());
             comp.parameters.push_back (std::move (ctrl));
@@ -376,7 +405,7 @@ void StardustEditor::organizeParametersSmartly (const juce::Array<juce::AudioPro
                 auto* p = *it;
                 availableParams.erase (it);
                 
-                auto ctrl = std::make_unique<ParameterControl> (*p, paramRule.label);
+                auto ctrl = std::make_unique<ParameterControl> (*this, *p, paramRule.label);
                 subComp->addAndMakeVisible (ctrl.get());
                 allControls.push_back (ctrl.get());
                 subComp->parameters.push_back (std::move (ctrl));
@@ -11,8 +11,16 @@ public:
     StardustEditor();
     ~StardustEditor() override;
 
+    void setRefreshRate (int hz)    { startTimerHz (hz); }
     void setProcessor (juce::AudioProcessor* newProcessor);
 
+    // Called for every slider move. When unset, the parameter is changed directly.
+    std::function<void (juce::AudioProcessorParameter&, float)> onParameterChange;
+
+    // Called with true when a drag starts and false when it ends. When unset, the
+    // parameter's gesture is begun and ended directly.
+    std::function<void (juce::AudioProcessorParameter&, bool)> onParameterGesture;
+
     void paint (juce::Graphics&) override;
     void resized() override;
 
@@ -20,12 +28,13 @@ private:
     //==============================================================================
     struct ParameterControl : public juce::Component
     {
-        ParameterControl (juce::AudioProcessorParameter& p, const juce::String& labelOverride = {});
+        ParameterControl (StardustEditor& owner, juce::AudioProcessorParameter& p, const juce::String& labelOverride = {});
         
         void paint (juce::Graphics& g) override;
         void resized() override;
         void syncFromParam();
 
+        StardustEditor& owner;
         juce::AudioProcessorParameter& param;
         juce::Slider slider;
         juce::Label nameLabel;